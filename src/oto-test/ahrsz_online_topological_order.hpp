@@ -16,12 +16,19 @@
 //     Zadeck, "Incremental Evaluation of Computational Circuits", 
 //     In Proc. of the First Annual ACM-SIAM Symposium on Discrete 
 //     Algorithms, pages 32-42, 1990.
+//
+// Priorities are never freed, so the priority space only grows, by
+// the new priorities handed out on each reassignment.  Optionally,
+// once it holds more than a given number of priorities per node, the
+// nodes are given fresh priorities in their current order, and the
+// rest are thrown away.  Nodes often share a priority, so a factor
+// below one is sensible.
 
 #ifndef AHRSZ_ONLINE_TOPOLOGICAL_ORDER_HPP
 #define AHRSZ_ONLINE_TOPOLOGICAL_ORDER_HPP
 
-#include <queue>
 #include <vector>
+#include <algorithm>
 #include <stdexcept>
 #include <cassert>
 #include <boost/property_map.hpp>
@@ -31,6 +38,10 @@
 #include "ordered_slist.hpp"
 #include "ordered_slist2.hpp"
 #include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+#include "dfs_frame.hpp"
+#include "work_budget.hpp"
 #include "myless.hpp"
 #include "mygreater.hpp"
 
@@ -59,6 +70,7 @@ class ahrsz_online_topological_order;
 extern unsigned int ahrsz_K;
 extern unsigned int ahrsz_dKfb;
 extern unsigned int ahrsz_ninvalid;
+extern unsigned int ahrsz_ncompacts;
 #endif
 
 // --------------------------------
@@ -202,6 +214,45 @@ public:
 // the main class
 // --------------
 
+// Bring the priorities up to date once t->h has gone into the
+// underlying graph.  Returns false, leaving them as they were,
+// if t->h closes a cycle (which is put in cycle, if given).
+
+template<class T, class PSPACE, class N2I>
+bool ahrsz_oto_insert(typename T::vertex_descriptor t, 
+		      typename T::vertex_descriptor h, 
+		      ahrsz_online_topological_order<T,PSPACE,N2I> &g,
+		      std::vector<typename T::vertex_descriptor> *cycle) {
+  typename boost::property_map<T, N2I>::type _pmap; 
+  _pmap = get(N2I(),g);
+  if(!(_pmap[t] < _pmap[h])) {
+    std::vector<typename T::vertex_descriptor> &K(g._K);
+    K.clear();
+    g._budget.start(num_vertices(g),num_edges(g));
+    if(cycle != NULL) { g._budget.lift(); }
+    if(g.discovery(t,h,K,cycle)) {
+      return false;
+    } else if(g._budget.exceeded()) {
+      // too much work, so start again
+      if(!g.resort()) { return false; }
+    } else {
+      g.reassignment(K);
+      g._budget.completed(K.size());
+      if(g._cfactor > 0 && g._pspace.size() > g._cfactor * num_vertices(g)) {
+	g.compact();
+#ifdef AHRSZ_GENERATE_STATS
+	++ahrsz_ncompacts;
+#endif
+      }
+    }
+#ifdef AHRSZ_GENERATE_STATS
+    ++ahrsz_ninvalid;
+    ahrsz_K += K.size();
+#endif
+  }
+  return true;
+}
+
 template<class T, class PSPACE, class N2I>
 std::pair<typename T::edge_descriptor, bool> 
 add_edge(typename ahrsz_online_topological_order<T,PSPACE,N2I>::vertex_descriptor t, 
@@ -212,19 +263,44 @@ add_edge(typename ahrsz_online_topological_order<T,PSPACE,N2I>::vertex_descripto
   r = add_edge(static_cast<typename T::vertex_descriptor>(t),
 	       static_cast<typename T::vertex_descriptor>(h),
 	       static_cast<T&>(g));
-  if(r.second) {
-    typename boost::property_map<T, N2I>::type _pmap; 
-    _pmap = get(N2I(),g);
-    if(!(_pmap[t] < _pmap[h])) {
-      std::vector<typename T::vertex_descriptor> K;     
-      g.discovery(t,h,K);  
-      g.reassignment(K);
-#ifdef AHRSZ_GENERATE_STATS
-      ++ahrsz_ninvalid;
-      ahrsz_K += K.size();
-#endif
-    }
+  if(r.second && !ahrsz_oto_insert<T,PSPACE,N2I>(t,h,g,NULL)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
   }
+  return r;
+}
+
+template<class T, class PSPACE, class N2I>
+oto_status
+try_add_edge(typename ahrsz_online_topological_order<T,PSPACE,N2I>::vertex_descriptor t, 
+	     typename ahrsz_online_topological_order<T,PSPACE,N2I>::vertex_descriptor h, 
+	     ahrsz_online_topological_order<T,PSPACE,N2I> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!ahrsz_oto_insert<T,PSPACE,N2I>(t,h,g,NULL)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+template<class T, class PSPACE, class N2I>
+oto_status
+try_add_edge(typename ahrsz_online_topological_order<T,PSPACE,N2I>::vertex_descriptor t, 
+	     typename ahrsz_online_topological_order<T,PSPACE,N2I>::vertex_descriptor h, 
+	     ahrsz_online_topological_order<T,PSPACE,N2I> &g,
+	     std::vector<typename T::vertex_descriptor> &cycle) {
+  cycle.clear();
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s == OTO_CYCLE) { cycle.push_back(h); }
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!ahrsz_oto_insert<T,PSPACE,N2I>(t,h,g,&cycle)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
 }
 
 
@@ -240,34 +316,68 @@ template<class T, class PSPACE = ordered_slist<void>, class N2I = n2i_t>
 class ahrsz_online_topological_order : public T {
 public:  
   typedef ahrsz_online_topological_order<T,PSPACE,N2I> self;
-  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor, 
-								  typename self::vertex_descriptor, 
-								  self &);
+  friend bool ahrsz_oto_insert<T,PSPACE,N2I>(typename T::vertex_descriptor, 
+					    typename T::vertex_descriptor, 
+					    self &,
+					    std::vector<typename T::vertex_descriptor> *);
 private:
   typedef typename self::vertex_descriptor vd_t;
   typedef typename T::out_edge_iterator out_iterator;
   typedef typename T::in_edge_iterator in_iterator;
-  typedef std::priority_queue<vd_t,std::vector<vd_t>,ahrsz_priority_comp<
-    T,N2I,std::less<ahrsz_priority_value<PSPACE> > > > max_priority_queue;
-  typedef std::priority_queue<vd_t,std::vector<vd_t>,ahrsz_priority_comp<
-    T,N2I,std::greater<ahrsz_priority_value<PSPACE> > > > min_priority_queue;
+  typedef dfs_frame<vd_t,out_iterator> out_frame;
+  // the frontiers are kept as heaps in plain vectors, so
+  // that their storage can be reused between insertions.
+  typedef ahrsz_priority_comp<T,N2I,std::less<ahrsz_priority_value<PSPACE> > > max_priority_comp;
+  typedef ahrsz_priority_comp<T,N2I,std::greater<ahrsz_priority_value<PSPACE> > > min_priority_comp;
   typedef typename boost::property_map<T, N2I>::type n2i_t;
+  typedef std::pair<vd_t,ahrsz_ext_priority_value<PSPACE> > Q_e;
+  typedef my_greater<Q_e,select2nd<Q_e> > Q_c;
 
   PSPACE _pspace; // the priority space.
+  double _cfactor; // priorities per node before compacting, or zero
   // temporary storage needed by the reassignment stage
   std::vector<ahrsz_ext_priority_value<PSPACE> > _ceiling;
-  std::vector<bool> _visited;
-  std::vector<bool> _inK;
+  visit_marks _visited;
+  visit_marks _inK;
+  // the nodes reached by each search, for spotting cycles
+  visit_marks _fside;
+  visit_marks _bside;
+  // how each was reached, only kept when the cycle is wanted
+  std::vector<vd_t> _fparent;
+  std::vector<vd_t> _bparent;
 #ifndef AHRSZ_USE_SIMPLE_REASSIGNMENT
+  // worked out afresh by each reassignment, so
+  // edges can be removed without touching it.
   std::vector<unsigned int> _indegree;
 #endif
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _K;
+  std::vector<vd_t> _forwfron;
+  std::vector<vd_t> _backfron;
+  std::vector<out_frame> _cstack;
+#ifdef AHRSZ_USE_SIMPLE_REASSIGNMENT
+  std::vector<vd_t> _rto;
+#else
+  std::vector<Q_e> _Q;
+  std::vector<vd_t> _Z;
+#endif
+  // state for falling back to an offline sort
+  work_budget _budget;
+  std::vector<vd_t> _order;
+  visit_marks _sortmarks;
+  visit_marks _done;
+  std::vector<out_frame> _sortstack;
 public:
   ahrsz_online_topological_order(T const &g, unsigned int a = 1) 
     : T(g), 
       _pspace(1), 
+      _cfactor(0),
       _ceiling(num_vertices(g),minus_infinity),
-      _visited(num_vertices(g),false),
-      _inK(num_vertices(g),false)
+      _visited(num_vertices(g)),
+      _inK(num_vertices(g)),
+      _fside(num_vertices(g)),
+      _bside(num_vertices(g))
 #ifndef AHRSZ_USE_SIMPLE_REASSIGNMENT
       ,_indegree(num_vertices(g),0) 
 #endif
@@ -286,8 +396,8 @@ public:
   }
 
   ahrsz_online_topological_order(typename T::vertices_size_type n, unsigned int a = 1) 
-    : T(n), _pspace(1), _ceiling(n,minus_infinity),
-      _visited(n,false), _inK(n,false)
+    : T(n), _pspace(1), _cfactor(0), _ceiling(n,minus_infinity),
+      _visited(n), _inK(n), _fside(n), _bside(n)
 #ifndef AHRSZ_USE_SIMPLE_REASSIGNMENT
       ,_indegree(n,0) 
 #endif
@@ -310,14 +420,54 @@ public:
       copy(src);
     }
   }
+
+  // abandon any discovery costing more than factor times an
+  // offline sort, and sort offline instead (zero turns off).
+  void set_budget(double factor) {
+    _budget.configure(factor);
+  }
+
+  // compact the priority space once it holds more
+  // than factor priorities per node (zero turns off).
+  void set_compact(double factor) {
+    _cfactor = factor;
+  }
+
+  // Give the nodes fresh priorities, one after another in their
+  // current order.  Nodes which shared a priority still do.
+  void compact(void) {
+    n2i_t n2i(get(N2I(),*this));
+    _order.clear();
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      _order.push_back(*i);
+    }
+    std::sort(_order.begin(),_order.end(),max_priority_comp(n2i));
+    // which nodes start a new priority, worked out
+    // before the old priority space is thrown away.
+    std::vector<bool> fresh(_order.size(),false);
+    for(unsigned int j=1;j<_order.size();++j) {
+      fresh[j] = n2i[_order[j-1]] != n2i[_order[j]];
+    }
+    _pspace=PSPACE(1);
+    typename PSPACE::iterator p(_pspace.begin());
+    for(unsigned int j=0;j!=_order.size();++j) {
+      if(fresh[j]) { p = _pspace.insert_after(p); }
+      n2i[_order[j]] = ahrsz_priority_value<PSPACE>(p,_pspace);
+    }
+  }
 protected:
 
   // -----------------------
   // the discovery algorithm
   // -----------------------
+
+  // Returns true if the searches meet, in which case something
+  // reachable from head reaches tail and tail->head closes a cycle.
+  // If cycle is given, it is then set to the path through there.
   
-  void discovery(vd_t tail, vd_t head,
-		 std::vector<vd_t> &K) 
+  bool discovery(vd_t tail, vd_t head,
+		 std::vector<vd_t> &K, std::vector<vd_t> *cycle) 
   {
     n2i_t n2i(get(N2I(),*this));
 
@@ -327,17 +477,30 @@ protected:
     
     vd_t f(head);
     vd_t b(tail);  
-    min_priority_queue ForwFron(get(N2I(),*this));  // the forward frontier
-    max_priority_queue BackFron(get(N2I(),*this));  // the backward frontier
+    std::vector<vd_t> &ForwFron(_forwfron);  // the forward frontier
+    std::vector<vd_t> &BackFron(_backfron);  // the backward frontier
+    min_priority_comp fcomp(n2i);
+    max_priority_comp bcomp(n2i);
     unsigned int ForwEdges(out_degree(head,*this));
     unsigned int BackEdges(in_degree(tail,*this));
-    ForwFron.push(head);
-    BackFron.push(tail);
+    ForwFron.clear();
+    BackFron.clear();
+    ForwFron.push_back(head);
+    BackFron.push_back(tail);
 
     // notice, I uses visited to indicate when 
     // a node is on one of the queues.
-    _visited[head]=true;
-    _visited[tail]=true;    
+    _visited.clear();
+    _visited.mark(head);
+    _visited.mark(tail);    
+    _fside.clear();
+    _bside.clear();
+    _fside.mark(head);
+    _bside.mark(tail);
+    if(cycle != NULL && _fparent.size() < num_vertices(*this)) {
+      _fparent.resize(num_vertices(*this));
+      _bparent.resize(num_vertices(*this));
+    }
 
     while(!(n2i[f] > n2i[b]) && !ForwFron.empty() && !BackFron.empty()) {
       unsigned int u=std::min(ForwEdges,BackEdges);
@@ -345,18 +508,27 @@ protected:
       BackEdges -= u;
 
       if(ForwEdges == 0) {
+	if(!_budget.charge(1 + out_degree(f,*this))) { break; }
 	K.push_back(f);
-	ForwFron.pop();
+	std::pop_heap(ForwFron.begin(),ForwFron.end(),fcomp);
+	ForwFron.pop_back();
 #ifdef AHRSZ_GENERATE_STATS
 	++ahrsz_dKfb;
 #endif
-	_visited[f]=false;
+	_visited.unmark(f);
 	out_iterator i,iend;
 	for(tie(i,iend) = out_edges(f,*this);i!=iend;++i) {
 	  vd_t w(target(*i,*this));
-	  if(!_visited[w]) {
-	    ForwFron.push(w);	
-	    _visited[w]=true;
+	  if(_bside.marked(w)) {
+	    if(cycle != NULL) { witness(head,f,w,tail,*cycle); }
+	    return true;
+	  }
+	  if(cycle != NULL && !_fside.marked(w)) { _fparent[w] = f; }
+	  _fside.mark(w);
+	  if(!_visited.marked(w)) {
+	    ForwFron.push_back(w);	
+	    std::push_heap(ForwFron.begin(),ForwFron.end(),fcomp);
+	    _visited.mark(w);
 	  }
 #ifdef AHRSZ_GENERATE_STATS
 	  ++ahrsz_dKfb;
@@ -365,23 +537,32 @@ protected:
 	if(ForwFron.empty()) {
 	  f = tail;
 	} else {	  
-	  f = ForwFron.top();
+	  f = ForwFron.front();
 	}
 	ForwEdges = out_degree(f,*this);
       }
       if(BackEdges == 0) {
+	if(!_budget.charge(1 + in_degree(b,*this))) { break; }
 	K.push_back(b);
-	BackFron.pop();
+	std::pop_heap(BackFron.begin(),BackFron.end(),bcomp);
+	BackFron.pop_back();
 #ifdef AHRSZ_GENERATE_STATS
 	++ahrsz_dKfb;
 #endif
-	_visited[b]=false;
+	_visited.unmark(b);
 	in_iterator i,iend;
 	for(tie(i,iend) = in_edges(b,*this);i!=iend;++i) {
 	  vd_t w(source(*i,*this));
-	  if(!_visited[w]) {
-	    BackFron.push(w);	
-	    _visited[w]=true;
+	  if(_fside.marked(w)) {
+	    if(cycle != NULL) { witness(head,w,b,tail,*cycle); }
+	    return true;
+	  }
+	  if(cycle != NULL && !_bside.marked(w)) { _bparent[w] = b; }
+	  _bside.mark(w);
+	  if(!_visited.marked(w)) {
+	    BackFron.push_back(w);	
+	    std::push_heap(BackFron.begin(),BackFron.end(),bcomp);
+	    _visited.mark(w);
 	  }
 #ifdef AHRSZ_GENERATE_STATS
 	  ++ahrsz_dKfb;
@@ -390,20 +571,24 @@ protected:
 	if(BackFron.empty()) {
 	  b = head;
 	} else {
-	  b = BackFron.top();
+	  b = BackFron.front();
 	}
 	BackEdges = in_degree(b,*this);
       }
     }
-    // Finally, unmark all remaining on queues
-    while(!ForwFron.empty()) {
-      _visited[ForwFron.top()]=false;
-      ForwFron.pop();
-    }
-    while(!BackFron.empty()) {
-      _visited[BackFron.top()]=false;
-      BackFron.pop();
+    return false;
+  }
+
+  // The path head,...,x found forwards, then y,...,tail
+  // found backwards, where x->y is an edge.
+
+  void witness(vd_t head, vd_t x, vd_t y, vd_t tail,
+	       std::vector<vd_t> &cycle) {
+    oto_witness(head,x,_fparent,cycle);
+    for(;y != tail;y = _bparent[y]) {
+      cycle.push_back(y);
     }
+    cycle.push_back(tail);
   }
 
   std::string a2str(ahrsz_ext_priority_value<PSPACE> x) {
@@ -429,17 +614,20 @@ protected:
   void reassignment(std::vector<vd_t> &K) {
     n2i_t n2i(get(N2I(),*this));
     // Initialise temporary data
+    _visited.clear();
+    _inK.clear();
     for(typename std::vector<vd_t>::iterator i(K.begin());
 	i!=K.end();++i) {
       _ceiling[*i] = plus_infinity;
-      _inK[*i] = true;
+      _inK.mark(*i);
     }
     // first pass - compute ceiling Information
 #ifdef AHRSZ_USE_SIMPLE_REASSIGNMENT
-    std::vector<vd_t> rto; // reverse topological order
+    std::vector<vd_t> &rto(_rto); // reverse topological order
+    rto.clear();
     for(typename std::vector<vd_t>::iterator i(K.begin());
 	i!=K.end();++i) {
-      if(!_visited[*i]) { compute_ceiling(*i,rto,n2i); }
+      if(!_visited.marked(*i)) { compute_ceiling(*i,rto,n2i); }
     }
 
     // second pass - perform the reassignment
@@ -451,14 +639,13 @@ protected:
     // first pass - compute ceiling Information
     for(typename std::vector<vd_t>::iterator i(K.begin());
 	i!=K.end();++i) {
-      if(!_visited[*i]) { compute_ceiling(*i,n2i); }
+      if(!_visited.marked(*i)) { compute_ceiling(*i,n2i); }
     }
     
     // construct the min-priority queue
-    typedef std::pair<vd_t,ahrsz_ext_priority_value<PSPACE> > Q_e;
-    typedef my_greater<Q_e,select2nd<Q_e> > Q_c;
-    typedef std::priority_queue<Q_e,std::vector<Q_e>,Q_c> Q_t;
-    Q_t Q;
+    std::vector<Q_e> &Q(_Q);
+    Q_c qcomp;
+    Q.clear();
 
     // initialise Q
     for(typename std::vector<vd_t>::iterator i(K.begin());i!=K.end();++i) {
@@ -466,27 +653,31 @@ protected:
       unsigned int kid = 0;
       typename T::in_edge_iterator j,jend;
       for(tie(j,jend) = in_edges(*i,*this);j!=jend;++j) {
-	if(_inK[source(*j,*this)]) { ++kid; }
+	if(_inK.marked(source(*j,*this))) { ++kid; }
 	floor = std::max(floor,ahrsz_ext_priority_value<PSPACE>(n2i[source(*j,*this)]));
       }
       _indegree[*i] = kid;
-      if(kid == 0) { Q.push(Q_e(*i,floor)); }
+      if(kid == 0) { 
+	Q.push_back(Q_e(*i,floor)); 
+	std::push_heap(Q.begin(),Q.end(),qcomp);
+      }
     }
 
     // now perform the reassignment
-    std::vector<vd_t> Z;
+    std::vector<vd_t> &Z(_Z);
     while(!Q.empty()) {
       Z.clear();
-      ahrsz_ext_priority_value<PSPACE> Z_floor = Q.top().second;
+      ahrsz_ext_priority_value<PSPACE> Z_floor = Q.front().second;
       ahrsz_ext_priority_value<PSPACE> Z_ceil = plus_infinity;
-      while(!Q.empty() && Q.top().second == Z_floor) {
-	vd_t x = Q.top().first;	
+      while(!Q.empty() && Q.front().second == Z_floor) {
+	vd_t x = Q.front().first;	
 	Z_ceil = std::min(Z_ceil,_ceiling[x]);
 	Z.push_back(x);
-	Q.pop();
+	std::pop_heap(Q.begin(),Q.end(),qcomp);
+	Q.pop_back();
       }
       
-      assert(Q.empty() || Z_floor < Q.top().second);
+      assert(Q.empty() || Z_floor < Q.front().second);
 
       // all of Z must get same priority
       ahrsz_ext_priority_value<PSPACE> Z_p = compute_priority(Z_floor,Z_ceil);
@@ -496,19 +687,14 @@ protected:
 	typename T::out_edge_iterator j,jend;
 	for(tie(j,jend) = out_edges(*i,*this);j!=jend;++j) {
 	  vd_t y(target(*j,*this));
-	  if(_inK[y] && --_indegree[y] == 0) {
-	    Q.push(std::make_pair(y,compute_floor(y,n2i)));
+	  if(_inK.marked(y) && --_indegree[y] == 0) {
+	    Q.push_back(std::make_pair(y,compute_floor(y,n2i)));
+	    std::push_heap(Q.begin(),Q.end(),qcomp);
 	  }
 	}
       } 
     }
 #endif
-
-    // reset visited information
-    for(typename std::vector<vd_t>::iterator i(K.begin());i!=K.end();++i) {
-      _visited[*i]=false;
-      _inK[*i]=false;
-    }
   }
   
   void compute_ceiling(vd_t n, 
@@ -516,27 +702,45 @@ protected:
 		       std::vector<vd_t> &rto, 
 #endif
 		       n2i_t n2i) {
-    _visited[n]=true;    
-    typename T::out_edge_iterator i,iend;
-    for(tie(i,iend) = out_edges(n,*this);i!=iend;++i) {
-      vd_t j(target(*i,*this));
-
-      if(_inK[j]) {
-	// successor is in K
+    // the stack is kept between calls
+    std::vector<out_frame> &stack(_cstack);
+    stack.clear();
+
+    _visited.mark(n);    
+    stack.push_back(out_frame(n,out_edges(n,*this)));
+
+    while(!stack.empty()) {
+      out_frame &f(stack.back());
+      if(f.i == f.iend) {
+	// all successors done, so pass
+	// the ceiling back to the parent
+	vd_t c(f.v);
 #ifdef AHRSZ_USE_SIMPLE_REASSIGNMENT
-	if(!_visited[j]) { compute_ceiling(j,rto,n2i); }
-#else
-	if(!_visited[j]) { compute_ceiling(j,n2i); }
+	rto.push_back(c);
 #endif
-	_ceiling[n] = std::min(_ceiling[j],_ceiling[n]);
+	stack.pop_back();
+	if(!stack.empty()) {
+	  vd_t p(stack.back().v);
+	  _ceiling[p] = std::min(_ceiling[c],_ceiling[p]);
+	}
+	continue;
+      }
+      vd_t j(target(*f.i,*this));
+      ++f.i;
+
+      if(_inK.marked(j)) {
+	// successor is in K
+	if(!_visited.marked(j)) { 
+	  _visited.mark(j);
+	  stack.push_back(out_frame(j,out_edges(j,*this)));
+	} else {
+	  _ceiling[f.v] = std::min(_ceiling[j],_ceiling[f.v]);
+	}
       } else {
 	// successor is not in K
-	_ceiling[n] = std::min(_ceiling[n],ahrsz_ext_priority_value<PSPACE>(n2i[j]));
+	_ceiling[f.v] = std::min(_ceiling[f.v],ahrsz_ext_priority_value<PSPACE>(n2i[j]));
       }       
     }
-#ifdef AHRSZ_USE_SIMPLE_REASSIGNMENT
-    rto.push_back(n);
-#endif
   }  
 
   ahrsz_ext_priority_value<PSPACE>
@@ -565,6 +769,33 @@ protected:
     return candidate;
   }
   
+  // -----------------------------
+  // the fallback offline sort
+  // -----------------------------
+
+  // throw away the priority space, and give every node a fresh
+  // priority in turn.  Returns false, changing nothing, on a cycle.
+  bool resort(void) {
+    n2i_t n2i(get(N2I(),*this));
+    unsigned int cost;
+    if(!offline_topological_sort(static_cast<T const &>(*this),_order,
+				 _sortmarks,_done,_sortstack,cost)) {
+      return false;
+    }
+    _pspace=PSPACE(1);
+    typename PSPACE::iterator p(_pspace.begin());
+    for(typename std::vector<vd_t>::iterator i(_order.begin());
+	i!=_order.end();++i) {
+      if(i != _order.begin()) { p = _pspace.insert_after(p); }
+      n2i[*i] = ahrsz_priority_value<PSPACE>(p,_pspace);
+    }
+    _budget.fallback(cost);
+#ifdef AHRSZ_GENERATE_STATS
+    ahrsz_dKfb += cost;
+#endif
+    return true;
+  }
+
   ahrsz_ext_priority_value<PSPACE> compute_floor(vd_t v, n2i_t n2i) {
     ahrsz_ext_priority_value<PSPACE> floor(minus_infinity);
     
@@ -580,6 +811,7 @@ private:
   void copy(ahrsz_online_topological_order const &src) {
     // invoke super assignment operator
     T::operator=(src);    
+    _cfactor = src._cfactor;
 
     // direct copy
     _pspace=PSPACE(1);
@@ -0,0 +1,581 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// This is the randomised algorithm from:
+//
+// [1] Aaron Bernstein and Shiri Chechik. Incremental topological sort
+//     and cycle detection in O(m sqrt(n)) expected total time. In Proc.
+//     ACM-SIAM Symposium on Discrete Algorithms (SODA), 2018.
+//
+// A random sample S of about sqrt(n) log n nodes is taken, and for
+// every node x the sets A(x) of sampled nodes which reach x, and D(x)
+// of sampled nodes which x reaches, are kept up to date.  Each sample
+// has one bit per node for either set, and inserting an edge u->v
+// simply pushes the samples in A(u) forward from v, and those in D(v)
+// backwards from u.  Since a node gains each sample at most once, the
+// total cost of this is O(m|S|).
+//
+// For an edge x->y, A(x) is a subset of A(y) and D(x) a superset of
+// D(y).  So, ordering the nodes by |A| and then by |D| (largest
+// first) is topological, except for nodes with exactly the same sets
+// (a "class").  Within a class, the order is given by a position, and
+// kept by running POTO1 on just the edges of that class.  Nodes with
+// the same counts but different sets have no edges between them, so
+// the class needn't be known explicitly: n2i holds (|A|,|D|,position).
+//
+// Only the edges touching nodes whose sets have changed (and the new
+// edge) can end up out of order.  A cycle through the new edge must
+// lie wholly in one class, so it is found by a search of the class.
+// All changes are logged, so that they can be undone when a cycle is
+// found.
+//
+// Removing an edge u->v can shrink A(x) for the nodes reachable from
+// v, and D(x) for those reaching u.  The sets from before are still
+// consistent with the smaller graph, so the order is left alone.
+// But, an insertion needs the sets to be exact, so the samples in
+// A(u) and D(v) are marked stale, and their sets are worked out
+// afresh just before the next insertion.  So, a run of removals
+// costs one search for each sample they made stale.
+//
+// The sample is drawn from a Mersenne twister, whose seed can be set
+// with reseed() so that runs can be repeated.
+
+#ifndef BC_ONLINE_TOPOLOGICAL_ORDER_HPP
+#define BC_ONLINE_TOPOLOGICAL_ORDER_HPP
+
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include <boost/property_map.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include <boost/random.hpp>
+#include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef BC_GENERATE_STATS
+extern unsigned int bc_ninvalid;
+extern unsigned int bc_ddxy;
+extern unsigned int bc_nchanged;
+#endif
+
+#define BC_DEFAULT_SEED 5489U
+
+// The key stored in n2i.
+
+struct bc_key {
+  unsigned int anc;  // |A(x)|
+  unsigned int desc; // |D(x)|
+  unsigned int pos;
+
+  bc_key() : anc(0), desc(0), pos(0) {}
+
+  bool operator<(bc_key const &k) const {
+    if(anc != k.anc) { return anc < k.anc; }
+    if(desc != k.desc) { return desc > k.desc; }
+    return pos < k.pos;
+  }
+
+  bool operator>(bc_key const &k) const { return k < *this; }
+
+  bool operator==(bc_key const &k) const {
+    return anc == k.anc && desc == k.desc && pos == k.pos;
+  }
+
+  bool operator!=(bc_key const &k) const { return !(*this == k); }
+
+  // could the two be in the same class?
+  bool same_class(bc_key const &k) const {
+    return anc == k.anc && desc == k.desc;
+  }
+};
+
+template<class T, class N2I>
+class bc_online_topological_order;
+
+template<class T, class N2I>
+std::pair<typename T::edge_descriptor, bool>
+add_edge(typename bc_online_topological_order<T,N2I>::vertex_descriptor u,
+	 typename bc_online_topological_order<T,N2I>::vertex_descriptor v,
+	 bc_online_topological_order<T,N2I> &g) {
+  std::pair<typename T::edge_descriptor, bool> r;
+  g.refresh();
+  r = add_edge(static_cast<typename T::vertex_descriptor>(u),
+	       static_cast<typename T::vertex_descriptor>(v),
+	       static_cast<T&>(g));
+  if(r.second && !g.insert(u,v)) {
+    remove_edge(u,v,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename bc_online_topological_order<T,N2I>::vertex_descriptor u,
+	     typename bc_online_topological_order<T,N2I>::vertex_descriptor v,
+	     bc_online_topological_order<T,N2I> &g) {
+  oto_status s(oto_check(u,v,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  g.refresh();
+  add_edge(u,v,static_cast<T&>(g));
+  if(!g.insert(u,v)) {
+    remove_edge(u,v,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+template<class T, class N2I>
+void remove_edge(typename bc_online_topological_order<T,N2I>::vertex_descriptor u,
+		 typename bc_online_topological_order<T,N2I>::vertex_descriptor v,
+		 bc_online_topological_order<T,N2I> &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  remove_edge(static_cast<vd_t>(u),static_cast<vd_t>(v),static_cast<T&>(g));
+  g.remove(u,v);
+}
+
+template<class InputIter, class T, class N2I>
+void add_edges(InputIter b, InputIter e,
+	       bc_online_topological_order<T,N2I> &g) {
+  for(;b!=e;++b) {
+    add_edge(b->first,b->second,g);
+  }
+}
+
+template<class T, class N2I = n2i_t>
+class bc_online_topological_order : public T {
+public:
+  typedef bc_online_topological_order<T,N2I> self;
+  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor,
+								  typename self::vertex_descriptor,
+								  self &);
+  friend oto_status try_add_edge<T>(typename self::vertex_descriptor,
+				    typename self::vertex_descriptor,
+				    self &);
+  friend void remove_edge<T>(typename self::vertex_descriptor,
+			     typename self::vertex_descriptor,
+			     self &);
+private:
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename T::out_edge_iterator out_iterator;
+  typedef typename T::in_edge_iterator in_iterator;
+  typedef typename boost::property_map<T, N2I>::type n2i_map;
+
+  std::vector<vd_t> _samples;
+  // _anc[k][x] if sample k reaches x, and
+  // _desc[k][x] if x reaches sample k.
+  std::vector<std::vector<bool> > _anc;
+  std::vector<std::vector<bool> > _desc;
+  // samples whose sets may be too big, since edges went
+  std::vector<bool> _astale;
+  std::vector<bool> _dstale;
+  bool _stale;
+  // the undo logs
+  std::vector<std::pair<unsigned int, vd_t> > _alog;
+  std::vector<std::pair<unsigned int, vd_t> > _dlog;
+  std::vector<std::pair<vd_t, unsigned int> > _plog;
+  // nodes whose sets (or positions) have changed
+  std::vector<vd_t> _changed;
+  visit_marks _cmarks;
+  visit_marks _fmarks;
+  visit_marks _bmarks;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _stack;
+  std::vector<vd_t> _reachable;
+  std::vector<vd_t> _reaching;
+  std::vector<unsigned int> _pool;
+public:
+  bc_online_topological_order(T const &g, unsigned int acc = 1)
+    : T(g), _cmarks(num_vertices(g)), _fmarks(num_vertices(g)),
+      _bmarks(num_vertices(g)) {
+    reseed(BC_DEFAULT_SEED);
+  }
+
+  bc_online_topological_order(typename T::vertices_size_type n,
+			      unsigned int acc = 1)
+    : T(n), _cmarks(n), _fmarks(n), _bmarks(n) {
+    reseed(BC_DEFAULT_SEED);
+  }
+
+  unsigned int nsamples(void) const { return _samples.size(); }
+
+  // Draw a new sample, and work out the sets and order
+  // from scratch.
+
+  void reseed(unsigned int seed) {
+    n2i_map n2i = get(N2I(),*this);
+    unsigned int n(num_vertices(*this));
+    boost::mt19937 gen(seed);
+    double p(n < 2 ? 1.0 : std::min(1.0,std::log((double) n) / std::sqrt((double) n)));
+    double limit(p * 4294967295.0);
+
+    _samples.clear();
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      if(gen() <= limit) { _samples.push_back(*i); }
+    }
+    _anc.assign(_samples.size(),std::vector<bool>(n,false));
+    _desc.assign(_samples.size(),std::vector<bool>(n,false));
+    _astale.assign(_samples.size(),false);
+    _dstale.assign(_samples.size(),false);
+    _stale = false;
+
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      n2i[*i] = bc_key();
+    }
+    for(unsigned int k=0;k!=_samples.size();++k) {
+      reach(k,_samples[k],true,NULL);
+      reach(k,_samples[k],false,NULL);
+    }
+
+    // use the topological sort function to
+    // order the vertices correctly ...
+    std::vector<vd_t> tmp;
+    tmp.reserve(n);
+    topological_sort(static_cast<T const &>(*this),std::back_inserter(tmp));
+    unsigned int pos(0);
+    for(typename std::vector<vd_t>::reverse_iterator j(tmp.rbegin());j!=tmp.rend();
+	++j) {
+      n2i[*j].pos = pos++;
+    }
+  }
+protected:
+  // Bring the samples and order up to date once u->v has gone
+  // into the underlying graph.  Returns false, with everything
+  // put back as it was, if u->v closes a cycle.
+
+  bool insert(vd_t u, vd_t v) {
+    n2i_map n2i = get(N2I(),*this);
+    bool before(n2i[v] < n2i[u]);
+    if(before && sample_cycle(u,v)) { return false; }
+    propagate(u,v);
+    // a cycle is only possible if v was
+    // before u, since the order was valid.
+    if(before && n2i[u].same_class(n2i[v]) && class_search(v,u)) {
+      undo();
+      return false;
+    }
+    repair(u,v);
+    return true;
+  }
+
+  // note the samples whose sets may
+  // have shrunk, now that u->v has gone
+  void remove(vd_t u, vd_t v) {
+    for(unsigned int k=0;k!=_samples.size();++k) {
+      if(_anc[k][u]) { _astale[k] = true; _stale = true; }
+      if(_desc[k][v]) { _dstale[k] = true; _stale = true; }
+    }
+  }
+
+  // Work out the sets of the stale samples afresh, and
+  // put right any edge which this leaves out of order.
+
+  void refresh(void) {
+    if(!_stale) { return; }
+    _plog.clear();
+    _changed.clear();
+    _cmarks.clear();
+    for(unsigned int k=0;k!=_samples.size();++k) {
+      if(_astale[k]) { rebuild(k,true); }
+      if(_dstale[k]) { rebuild(k,false); }
+    }
+    _astale.assign(_samples.size(),false);
+    _dstale.assign(_samples.size(),false);
+    _stale = false;
+#ifdef BC_GENERATE_STATS
+    bc_nchanged += _changed.size();
+#endif
+    repair();
+  }
+
+  // a sample on a cycle through u->v?
+  bool sample_cycle(vd_t u, vd_t v) {
+    for(unsigned int k=0;k!=_samples.size();++k) {
+      if(_anc[k][u] && _desc[k][v]) { return true; }
+    }
+    return false;
+  }
+
+  // bring the sets up to date after adding u->v
+  void propagate(vd_t u, vd_t v) {
+    _alog.clear();
+    _dlog.clear();
+    _plog.clear();
+    _changed.clear();
+    _cmarks.clear();
+    for(unsigned int k=0;k!=_samples.size();++k) {
+      if(_anc[k][u] && !_anc[k][v]) { reach(k,v,true,&_alog); }
+      if(_desc[k][v] && !_desc[k][u]) { reach(k,u,false,&_dlog); }
+    }
+#ifdef BC_GENERATE_STATS
+    bc_nchanged += _changed.size();
+#endif
+  }
+
+  // Search the class of v for u.  The class is closed
+  // under paths between its members, so this is exact.
+
+  bool class_search(vd_t v, vd_t u) {
+    n2i_map n2i = get(N2I(),*this);
+    std::vector<vd_t> &stack(_stack);
+    stack.clear();
+    _fmarks.clear();
+    _fmarks.mark(v);
+    stack.push_back(v);
+    while(!stack.empty()) {
+      vd_t x(stack.back());
+      stack.pop_back();
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(x,*this);i!=iend;++i) {
+	vd_t y(target(*i,*this));
+#ifdef BC_GENERATE_STATS
+	++bc_ddxy;
+#endif
+	if(y == u) {
+	  return true;
+	} else if(!_fmarks.marked(y) && n2i[y].same_class(n2i[v])) {
+	  _fmarks.mark(y);
+	  stack.push_back(y);
+	}
+      }
+    }
+    return false;
+  }
+
+  // undo everything done by propagate and repair
+  void undo(void) {
+    n2i_map n2i = get(N2I(),*this);
+    for(unsigned int i=_alog.size();i-- > 0;) {
+      _anc[_alog[i].first][_alog[i].second] = false;
+      --n2i[_alog[i].second].anc;
+    }
+    for(unsigned int i=_dlog.size();i-- > 0;) {
+      _desc[_dlog[i].first][_dlog[i].second] = false;
+      --n2i[_dlog[i].second].desc;
+    }
+    for(unsigned int i=_plog.size();i-- > 0;) {
+      n2i[_plog[i].first].pos = _plog[i].second;
+    }
+  }
+
+  // Put right any edge which is now out of order.  These
+  // can only be u->v, or those touching a changed node.  A
+  // node moved by reorder() is queued as if it had changed,
+  // so that no edge is left unchecked after it was moved.
+
+  void repair(vd_t u, vd_t v) {
+    check(u,v);
+    repair();
+  }
+
+  void repair(void) {
+    for(unsigned int k=0;k!=_changed.size();++k) {
+      vd_t x(_changed[k]);
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(x,*this);i!=iend;++i) {
+	check(x,target(*i,*this));
+      }
+      in_iterator j,jend;
+      for(tie(j,jend) = in_edges(x,*this);j!=jend;++j) {
+	check(source(*j,*this),x);
+      }
+    }
+  }
+private:
+  // Mark everything reachable from x (forwards if anc, otherwise
+  // backwards) as reached by sample k.  Nodes already marked are
+  // not gone past.
+
+  void reach(unsigned int k, vd_t x, bool anc,
+	     std::vector<std::pair<unsigned int, vd_t> > *log) {
+    n2i_map n2i = get(N2I(),*this);
+    std::vector<bool> &bits(anc ? _anc[k] : _desc[k]);
+    std::vector<vd_t> &stack(_stack);
+    stack.clear();
+    bits[x] = true;
+    stack.push_back(x);
+    while(!stack.empty()) {
+      vd_t y(stack.back());
+      stack.pop_back();
+      if(anc) { ++n2i[y].anc; } else { ++n2i[y].desc; }
+      if(log != NULL) {
+	log->push_back(std::make_pair(k,y));
+	if(!_cmarks.marked(y)) {
+	  _cmarks.mark(y);
+	  _changed.push_back(y);
+	}
+      }
+      if(anc) {
+	out_iterator i,iend;
+	for(tie(i,iend) = out_edges(y,*this);i!=iend;++i) {
+	  vd_t z(target(*i,*this));
+#ifdef BC_GENERATE_STATS
+	  ++bc_ddxy;
+#endif
+	  if(!bits[z]) { bits[z] = true; stack.push_back(z); }
+	}
+      } else {
+	in_iterator i,iend;
+	for(tie(i,iend) = in_edges(y,*this);i!=iend;++i) {
+	  vd_t z(source(*i,*this));
+#ifdef BC_GENERATE_STATS
+	  ++bc_ddxy;
+#endif
+	  if(!bits[z]) { bits[z] = true; stack.push_back(z); }
+	}
+      }
+    }
+  }
+
+  // Clear the bits of sample k, and then mark everything it
+  // reaches again.  Those which are no longer reached have
+  // changed.
+
+  void rebuild(unsigned int k, bool anc) {
+    n2i_map n2i = get(N2I(),*this);
+    std::vector<bool> &bits(anc ? _anc[k] : _desc[k]);
+    std::vector<vd_t> &old(_reaching);
+    old.clear();
+    unsigned int n(num_vertices(*this));
+    for(unsigned int x=0;x!=n;++x) {
+      if(bits[x]) {
+	bits[x] = false;
+	if(anc) { --n2i[x].anc; } else { --n2i[x].desc; }
+	old.push_back(x);
+      }
+    }
+    reach(k,_samples[k],anc,NULL);
+    for(unsigned int i=0;i!=old.size();++i) {
+      vd_t x(old[i]);
+      if(!bits[x] && !_cmarks.marked(x)) {
+	_cmarks.mark(x);
+	_changed.push_back(x);
+      }
+    }
+  }
+
+  void check(vd_t x, vd_t y) {
+    n2i_map n2i = get(N2I(),*this);
+    if(n2i[y] < n2i[x]) { reorder(x,y); }
+  }
+
+  // The edge x->y is out of order, but both are in the same
+  // class.  So, do just what POTO1 does within the class.  Other
+  // edges may be out of order as well, so both searches must stay
+  // within the positions between y and x.  Otherwise, they could
+  // pick up nodes from beyond either end, and moving those could
+  // put an edge out of order which was already checked.
+
+  void reorder(vd_t x, vd_t y) {
+    n2i_map n2i = get(N2I(),*this);
+    bc_key key(n2i[x]);
+    unsigned int lb(n2i[y].pos);
+    unsigned int ub(n2i[x].pos);
+    std::vector<vd_t> &stack(_stack);
+    std::vector<vd_t> &reachable(_reachable);
+    std::vector<vd_t> &reaching(_reaching);
+#ifdef BC_GENERATE_STATS
+    ++bc_ninvalid;
+#endif
+
+    // forwards from y ...
+    reachable.clear();
+    stack.clear();
+    _fmarks.clear();
+    _fmarks.mark(y);
+    stack.push_back(y);
+    while(!stack.empty()) {
+      vd_t a(stack.back());
+      stack.pop_back();
+      reachable.push_back(a);
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(a,*this);i!=iend;++i) {
+	vd_t b(target(*i,*this));
+#ifdef BC_GENERATE_STATS
+	++bc_ddxy;
+#endif
+	if(!_fmarks.marked(b) && n2i[b].same_class(key) &&
+	   n2i[b].pos > lb && n2i[b].pos < ub) {
+	  _fmarks.mark(b);
+	  stack.push_back(b);
+	}
+      }
+    }
+    // ... and backwards from x
+    reaching.clear();
+    _bmarks.clear();
+    _bmarks.mark(x);
+    stack.push_back(x);
+    while(!stack.empty()) {
+      vd_t a(stack.back());
+      stack.pop_back();
+      reaching.push_back(a);
+      in_iterator i,iend;
+      for(tie(i,iend) = in_edges(a,*this);i!=iend;++i) {
+	vd_t b(source(*i,*this));
+#ifdef BC_GENERATE_STATS
+	++bc_ddxy;
+#endif
+	if(!_bmarks.marked(b) && n2i[b].same_class(key) &&
+	   n2i[b].pos > lb && n2i[b].pos < ub) {
+	  _bmarks.mark(b);
+	  stack.push_back(b);
+	}
+      }
+    }
+
+    // now, pool the positions and hand them
+    // out, with the reaching nodes first.
+    pos_comp comp(n2i);
+    std::sort(reaching.begin(),reaching.end(),comp);
+    std::sort(reachable.begin(),reachable.end(),comp);
+    _pool.clear();
+    for(unsigned int i=0;i!=reaching.size();++i) {
+      _pool.push_back(n2i[reaching[i]].pos);
+    }
+    for(unsigned int i=0;i!=reachable.size();++i) {
+      _pool.push_back(n2i[reachable[i]].pos);
+    }
+    std::sort(_pool.begin(),_pool.end());
+    unsigned int p(0);
+    for(unsigned int i=0;i!=reaching.size();++i,++p) {
+      move(reaching[i],_pool[p]);
+    }
+    for(unsigned int i=0;i!=reachable.size();++i,++p) {
+      move(reachable[i],_pool[p]);
+    }
+  }
+
+  void move(vd_t x, unsigned int pos) {
+    n2i_map n2i = get(N2I(),*this);
+    if(n2i[x].pos == pos) { return; }
+    _plog.push_back(std::make_pair(x,n2i[x].pos));
+    n2i[x].pos = pos;
+    if(!_cmarks.marked(x)) {
+      _cmarks.mark(x);
+      _changed.push_back(x);
+    }
+  }
+
+  struct pos_comp {
+    n2i_map n2i;
+    pos_comp(n2i_map m) : n2i(m) {}
+    bool operator()(vd_t a, vd_t b) const { return n2i[a].pos < n2i[b].pos; }
+  };
+};
+
+#endif
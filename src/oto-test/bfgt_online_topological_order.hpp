@@ -0,0 +1,433 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// This is the algorithm for sparse graphs from:
+//
+// [1] Michael A. Bender, Jeremy T. Fineman, Seth Gilbert and Robert
+//     E. Tarjan. A new approach to incremental cycle detection and
+//     related problems. ACM Transactions on Algorithms, 2016.
+//
+// Each node has a level, and the levels form a pseudo-topological
+// order (i.e. k(x) <= k(y) for every edge x->y).  The order itself
+// is by level, with ties broken by a position within the level.  So,
+// n2i holds the pair (level,position) rather than a plain index.
+//
+// Inserting an edge v->w which is out of order first searches
+// backwards from v, but only through nodes on the same level as v,
+// and for at most D = min(sqrt(m),n^(2/3)) edges.  Then:
+//
+//   (a) if the search finished and k(w) = k(v), the nodes found (B)
+//       are moved to the front of their level.
+//
+//   (b) if the search finished and k(w) < k(v), w is raised to k(v).
+//
+//   (c) if the search was cut short, w is raised to k(v)+1, and B is
+//       taken to be just v.
+//
+// In cases (b) and (c), a forward search from w then raises every
+// node it reaches below the new level to that level, and these (F)
+// are moved to the front of it, after B.  A cycle is found if either
+// search meets the other side.  The same-level predecessors of each
+// node are kept in a list, so that the backward search never looks
+// at edges from lower levels.
+//
+// Since nodes are only ever moved to the front of a level, and the
+// positions on different levels are never compared, the positions
+// are simply handed out from one counter running downwards.
+//
+// Neither search changes anything, so that the levels and lists are
+// left as they were when a cycle is found.
+
+#ifndef BFGT_ONLINE_TOPOLOGICAL_ORDER_HPP
+#define BFGT_ONLINE_TOPOLOGICAL_ORDER_HPP
+
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include <climits>
+#include <boost/property_map.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+#include "dfs_frame.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef BFGT_GENERATE_STATS
+extern unsigned int bfgt_ninvalid;
+extern unsigned int bfgt_ddxy;
+extern unsigned int bfgt_nraised;
+#endif
+
+// the first position handed out
+#define BFGT_FIRST_POSITION (UINT_MAX / 2)
+
+// The key stored in n2i.
+
+struct bfgt_key {
+  unsigned int level;
+  unsigned int pos;
+
+  bfgt_key() : level(1), pos(BFGT_FIRST_POSITION) {}
+
+  bfgt_key(unsigned int l, unsigned int p) : level(l), pos(p) {}
+
+  bool operator<(bfgt_key const &k) const {
+    return level < k.level || (level == k.level && pos < k.pos);
+  }
+
+  bool operator>(bfgt_key const &k) const { return k < *this; }
+
+  bool operator==(bfgt_key const &k) const {
+    return level == k.level && pos == k.pos;
+  }
+
+  bool operator!=(bfgt_key const &k) const { return !(*this == k); }
+};
+
+template<class T, class N2I>
+class bfgt_online_topological_order;
+
+// Search backwards from v through the same-level predecessors,
+// traversing at most delta edges.  The nodes found are left in
+// _B.  Returns true if w is found, or false otherwise, and sets
+// complete if the search wasn't cut short.
+
+template<class T, class N2I>
+bool bfgt_oto_back(typename T::vertex_descriptor v,
+		   typename T::vertex_descriptor w,
+		   unsigned int delta, bool &complete,
+		   bfgt_online_topological_order<T,N2I> &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  std::vector<vd_t> &B(g._B);
+  std::vector<vd_t> &stack(g._bstack);
+  unsigned int narcs(0);
+
+  B.clear();
+  stack.clear();
+  g._bmarks.clear();
+  g._bmarks.mark(v);
+  B.push_back(v);
+  stack.push_back(v);
+  complete = true;
+
+  while(!stack.empty()) {
+    vd_t x(stack.back());
+    stack.pop_back();
+    std::vector<vd_t> &in(g._in[x]);
+    for(typename std::vector<vd_t>::iterator i(in.begin());i!=in.end();++i) {
+      if(narcs == delta) {
+	complete = false;
+	return false;
+      }
+      ++narcs;
+#ifdef BFGT_GENERATE_STATS
+      ++bfgt_ddxy;
+#endif
+      vd_t u(*i);
+      if(u == w) {
+	return true;
+      } else if(!g._bmarks.marked(u)) {
+	g._bmarks.mark(u);
+	B.push_back(u);
+	stack.push_back(u);
+      }
+    }
+  }
+  return false;
+}
+
+// Search forwards from w through the nodes below level, which
+// are to be raised to it.  The nodes found are left in _F in
+// post-order, and the edges which will be same-level afterwards
+// in _pending.  Returns true if a node in B is found.
+
+template<class T, class N2I>
+bool bfgt_oto_fwd(typename T::vertex_descriptor w, unsigned int level,
+		  typename boost::property_map<T, N2I>::type n2i,
+		  bfgt_online_topological_order<T,N2I> &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename T::out_edge_iterator out_iterator;
+  typedef dfs_frame<vd_t,out_iterator> frame;
+  std::vector<frame> &stack(g._fstack);
+  std::vector<vd_t> &F(g._F);
+
+  F.clear();
+  g._pending.clear();
+  stack.clear();
+  g._fmarks.clear();
+  g._fmarks.mark(w);
+  stack.push_back(frame(w,out_edges(w,g)));
+
+  while(!stack.empty()) {
+    frame &f(stack.back());
+    if(f.i == f.iend) {
+      F.push_back(f.v);
+      stack.pop_back();
+      continue;
+    }
+    vd_t x(f.v);
+    vd_t y(target(*f.i,g));
+    ++f.i;
+#ifdef BFGT_GENERATE_STATS
+    ++bfgt_ddxy;
+#endif
+    if(g._bmarks.marked(y)) {
+      return true;
+    } else if(g._fmarks.marked(y)) {
+      g._pending.push_back(std::make_pair(x,y));
+    } else if(n2i[y].level < level) {
+      g._fmarks.mark(y);
+      g._pending.push_back(std::make_pair(x,y));
+      stack.push_back(frame(y,out_edges(y,g)));
+    } else if(n2i[y].level == level) {
+      g._pending.push_back(std::make_pair(x,y));
+    }
+  }
+  return false;
+}
+
+// Bring the order up to date once v->w has gone into the
+// underlying graph.  Returns false, leaving the order as
+// it was, if v->w closes a cycle.  Nothing is changed until
+// both searches are over, so there is nothing to undo.
+
+template<class T, class N2I>
+bool bfgt_oto_insert(typename T::vertex_descriptor v,
+		     typename T::vertex_descriptor w,
+		     bfgt_online_topological_order<T,N2I> &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  if(n2i[v] < n2i[w]) {
+    if(n2i[v].level == n2i[w].level) { g._in[w].push_back(v); }
+    return true;
+  }
+#ifdef BFGT_GENERATE_STATS
+  ++bfgt_ninvalid;
+#endif
+
+  unsigned int delta((unsigned int) std::min(std::sqrt((double) num_edges(g)),
+					     std::pow((double) num_vertices(g),2.0/3.0)));
+  if(delta == 0) { delta = 1; }
+  bool complete;
+  if(bfgt_oto_back<T,N2I>(v,w,delta,complete,g)) {
+    return false;
+  }
+
+  unsigned int level(n2i[v].level);
+  if(!complete) {
+    // case (c)
+    ++level;
+    g._B.clear();
+    g._bmarks.clear();
+    g._bmarks.mark(v);
+  } else if(n2i[w].level == level) {
+    // case (a)
+    g.to_front(g._B.begin(),g._B.end(),false);
+    g._in[w].push_back(v);
+    return true;
+  }
+
+  // cases (b) and (c)
+  if(bfgt_oto_fwd<T,N2I>(w,level,n2i,g)) {
+    return false;
+  }
+  for(typename std::vector<vd_t>::iterator i(g._F.begin());i!=g._F.end();++i) {
+    n2i[*i].level = level;
+    g._in[*i].clear();
+  }
+  for(typename std::vector<std::pair<vd_t,vd_t> >::iterator i(g._pending.begin());
+      i!=g._pending.end();++i) {
+    g._in[i->second].push_back(i->first);
+  }
+  if(n2i[v].level == level) { g._in[w].push_back(v); }
+  // B must end up in front of F, so F is moved to the front first.
+  g.to_front(g._F.begin(),g._F.end(),true);
+  g.to_front(g._B.begin(),g._B.end(),false);
+#ifdef BFGT_GENERATE_STATS
+  bfgt_nraised += g._F.size();
+#endif
+  return true;
+}
+
+template<class T, class N2I>
+std::pair<typename T::edge_descriptor, bool>
+add_edge(typename bfgt_online_topological_order<T,N2I>::vertex_descriptor v,
+	 typename bfgt_online_topological_order<T,N2I>::vertex_descriptor w,
+	 bfgt_online_topological_order<T,N2I> &g) {
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(v),
+	       static_cast<typename T::vertex_descriptor>(w),
+	       static_cast<T&>(g));
+
+  if(r.second && !bfgt_oto_insert<T,N2I>(v,w,g)) {
+    remove_edge(v,w,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename bfgt_online_topological_order<T,N2I>::vertex_descriptor v,
+	     typename bfgt_online_topological_order<T,N2I>::vertex_descriptor w,
+	     bfgt_online_topological_order<T,N2I> &g) {
+  oto_status s(oto_check(v,w,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(v,w,static_cast<T&>(g));
+  if(!bfgt_oto_insert<T,N2I>(v,w,g)) {
+    remove_edge(v,w,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+// Removing v->w leaves the levels valid, so only the list
+// of same-level predecessors of w need change.
+
+template<class T, class N2I>
+void remove_edge(typename bfgt_online_topological_order<T,N2I>::vertex_descriptor v,
+		 typename bfgt_online_topological_order<T,N2I>::vertex_descriptor w,
+		 bfgt_online_topological_order<T,N2I> &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  remove_edge(static_cast<vd_t>(v),static_cast<vd_t>(w),static_cast<T&>(g));
+  std::vector<vd_t> &in(g._in[w]);
+  in.erase(std::remove(in.begin(),in.end(),static_cast<vd_t>(v)),in.end());
+}
+
+template<class InputIter, class T, class N2I>
+void add_edges(InputIter b, InputIter e,
+	       bfgt_online_topological_order<T,N2I> &g) {
+  for(;b!=e;++b) {
+    add_edge(b->first,b->second,g);
+  }
+}
+
+template<class T, class N2I = n2i_t>
+class bfgt_online_topological_order : public T {
+public:
+  typedef bfgt_online_topological_order<T,N2I> self;
+  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor,
+								  typename self::vertex_descriptor,
+								  self &);
+  friend bool bfgt_oto_back<T,N2I>(typename self::vertex_descriptor v,
+				   typename self::vertex_descriptor w,
+				   unsigned int delta, bool &complete,
+				   self &g);
+  friend bool bfgt_oto_fwd<T,N2I>(typename self::vertex_descriptor w,
+				  unsigned int level,
+				  typename boost::property_map<T, N2I>::type n2i,
+				  self &g);
+  friend bool bfgt_oto_insert<T,N2I>(typename self::vertex_descriptor v,
+				     typename self::vertex_descriptor w,
+				     self &g);
+  friend void remove_edge<T>(typename self::vertex_descriptor,
+			     typename self::vertex_descriptor,
+			     self &);
+private:
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename T::out_edge_iterator out_iterator;
+  typedef typename boost::property_map<T, N2I>::type n2i_map;
+
+  // same-level predecessors of each node
+  std::vector<std::vector<vd_t> > _in;
+  unsigned int _front; // last position handed out
+  visit_marks _bmarks;
+  visit_marks _fmarks;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _B;
+  std::vector<vd_t> _F;
+  std::vector<vd_t> _bstack;
+  std::vector<dfs_frame<vd_t,out_iterator> > _fstack;
+  std::vector<std::pair<vd_t,vd_t> > _pending;
+public:
+  bfgt_online_topological_order(T const &g, unsigned int acc = 1)
+    : T(g), _in(num_vertices(g)), _front(BFGT_FIRST_POSITION),
+      _bmarks(num_vertices(g)), _fmarks(num_vertices(g)) {
+
+    // use the topological sort function to
+    // order the vertices correctly ...
+    std::vector<unsigned int> tmp;
+    tmp.reserve(num_vertices(g));
+    topological_sort(g,std::back_inserter(tmp));
+    // ... and put them all on the first level
+    n2i_map n2i = get(N2I(),*this);
+    unsigned int pos(BFGT_FIRST_POSITION);
+    for(std::vector<unsigned int>::reverse_iterator i(tmp.rbegin());i!=tmp.rend();
+	++i) {
+      n2i[*i]=bfgt_key(1,pos++);
+    }
+    typename T::edge_iterator i,iend;
+    for(tie(i,iend) = edges(*this);i!=iend;++i) {
+      _in[target(*i,*this)].push_back(source(*i,*this));
+    }
+  }
+
+  bfgt_online_topological_order(typename T::vertices_size_type n,
+				unsigned int acc = 1)
+    : T(n), _in(n), _front(BFGT_FIRST_POSITION), _bmarks(n), _fmarks(n) {
+    n2i_map n2i = get(N2I(),*this);
+
+    unsigned int pos(BFGT_FIRST_POSITION);
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      n2i[*i]=bfgt_key(1,pos++);
+    }
+  }
+private:
+  // Move the nodes to the front of their levels.  They
+  // are given in order, or in reverse order if reversed.
+
+  template<class Iter>
+  void to_front(Iter b, Iter e, bool reversed) {
+    n2i_map n2i = get(N2I(),*this);
+    if(b == e) { return; }
+    if(_front < (unsigned int) (e - b)) { renumber(); }
+    if(!reversed) {
+      // put them back in the original order
+      std::sort(b,e,key_comp(n2i));
+      std::reverse(b,e);
+    }
+    for(;b!=e;++b) {
+      n2i[*b].pos = --_front;
+    }
+  }
+
+  // the positions have run out, so hand them out afresh
+  void renumber(void) {
+    n2i_map n2i = get(N2I(),*this);
+    std::vector<vd_t> &tmp(_bstack);
+    tmp.clear();
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      tmp.push_back(*i);
+    }
+    std::sort(tmp.begin(),tmp.end(),key_comp(n2i));
+    _front = BFGT_FIRST_POSITION;
+    unsigned int pos(BFGT_FIRST_POSITION);
+    for(typename std::vector<vd_t>::iterator j(tmp.begin());j!=tmp.end();++j) {
+      n2i[*j].pos = pos++;
+    }
+  }
+
+  struct key_comp {
+    n2i_map n2i;
+    key_comp(n2i_map m) : n2i(m) {}
+    bool operator()(vd_t a, vd_t b) const { return n2i[a] < n2i[b]; }
+  };
+};
+
+#endif
@@ -0,0 +1,99 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// A matrix of bits, stored row by row in machine words.  Each row
+// starts on a word boundary, so that a row can be scanned a word at
+// a time.  A single row is also used as a set of flags, where the
+// set bits in a range are needed in order.
+
+#ifndef BIT_MATRIX_HPP
+#define BIT_MATRIX_HPP
+
+#include <vector>
+#include <climits>
+
+typedef unsigned long bits_word;
+
+#define BITS_PER_WORD (sizeof(bits_word) * CHAR_BIT)
+
+// the index of the lowest set bit in a (non-zero) word
+inline unsigned int bits_lowest(bits_word w) {
+#ifdef __GNUC__
+  return __builtin_ctzl(w);
+#else
+  unsigned int i(0);
+  while(!(w & 1)) { w >>= 1; ++i; }
+  return i;
+#endif
+}
+
+// Returns the first column in [b,e) which is set in row, but not
+// in mask (if given), or e if there is none.  nwords is increased
+// by the number of words looked at.
+
+inline unsigned int bits_find(bits_word const *row, bits_word const *mask,
+			      unsigned int b, unsigned int e,
+			      unsigned int &nwords) {
+  if(b >= e) { return e; }
+  unsigned int i(b / BITS_PER_WORD);
+  unsigned int last((e - 1) / BITS_PER_WORD);
+  bits_word w(row[i]);
+  if(mask != NULL) { w &= ~mask[i]; }
+  w &= ~((bits_word) 0) << (b % BITS_PER_WORD);
+  ++nwords;
+  while(w == 0) {
+    if(++i > last) { return e; }
+    w = row[i];
+    if(mask != NULL) { w &= ~mask[i]; }
+    ++nwords;
+  }
+  unsigned int c(i * BITS_PER_WORD + bits_lowest(w));
+  return c < e ? c : e;
+}
+
+class bit_matrix {
+private:
+  unsigned int _nrows;
+  unsigned int _ncols;
+  unsigned int _nwords; // per row
+  std::vector<bits_word> _bits;
+public:
+  bit_matrix(unsigned int nrows = 0, unsigned int ncols = 0) {
+    resize(nrows,ncols);
+  }
+
+  unsigned int rows(void) const { return _nrows; }
+  unsigned int cols(void) const { return _ncols; }
+
+  // this clears every bit
+  void resize(unsigned int nrows, unsigned int ncols) {
+    _nrows = nrows;
+    _ncols = ncols;
+    _nwords = (ncols + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    _bits.assign(_nrows * _nwords,0);
+  }
+
+  bits_word *row(unsigned int r) { return &_bits[r * _nwords]; }
+  bits_word const *row(unsigned int r) const { return &_bits[r * _nwords]; }
+
+  bool test(unsigned int r, unsigned int c) const {
+    return (row(r)[c / BITS_PER_WORD] >> (c % BITS_PER_WORD)) & 1;
+  }
+
+  void set(unsigned int r, unsigned int c) {
+    row(r)[c / BITS_PER_WORD] |= ((bits_word) 1) << (c % BITS_PER_WORD);
+  }
+
+  void reset(unsigned int r, unsigned int c) {
+    row(r)[c / BITS_PER_WORD] &= ~(((bits_word) 1) << (c % BITS_PER_WORD));
+  }
+};
+
+#endif
@@ -0,0 +1,178 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// This decides what must be recomputed when some nodes change, as in
+// a build system or spreadsheet.  Nodes are marked dirty, and then
+// propagate() calls a function on each of them, and on each node
+// reachable from them, in topological order.  When the function
+// reports that a node did not change, its successors are not visited
+// on its account.  Each node is visited at most once.
+//
+// Only n2i is needed, so this works with any of the online
+// topological orders, and edges can be added between propagations.
+// The nodes waiting to be visited are kept in a queue ordered by
+// n2i.  When n2i is an unsigned int, this is a bucket queue with one
+// bucket per index.  A node's successors always have higher indices
+// than it, so the buckets are only ever scanned forwards, a word of
+// flags at a time.  Otherwise (e.g. for the priorities of AHRSZ), it
+// is a binary heap.
+
+#ifndef CHANGE_PROPAGATION_HPP
+#define CHANGE_PROPAGATION_HPP
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <boost/property_map.hpp>
+#include "bit_matrix.hpp"
+#include "visit_marks.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef PROPAGATE_GENERATE_STATS
+extern unsigned int prop_nvisited;
+extern unsigned int prop_nwords;
+#endif
+
+// A binary heap, lowest key first
+
+template<class K, class V>
+class propagation_queue {
+private:
+  typedef std::pair<K,V> entry;
+
+  struct entry_comp {
+    bool operator()(entry const &a, entry const &b) const {
+      return b.first < a.first;
+    }
+  };
+
+  std::vector<entry> _heap;
+public:
+  bool empty(void) const { return _heap.empty(); }
+
+  void push(K const &k, V v) {
+    _heap.push_back(entry(k,v));
+    std::push_heap(_heap.begin(),_heap.end(),entry_comp());
+  }
+
+  V pop(void) {
+    std::pop_heap(_heap.begin(),_heap.end(),entry_comp());
+    V v(_heap.back().second);
+    _heap.pop_back();
+    return v;
+  }
+};
+
+// A bucket queue, for when the keys are indices.  Each bucket is
+// a list threaded through _link, so that nodes may share an index
+// (as the members of a component do for SCC).  The values must be
+// vertex indices.
+
+template<class V>
+class propagation_queue<unsigned int, V> {
+private:
+  std::vector<bits_word> _bits; // which buckets are in use
+  std::vector<V> _head;
+  std::vector<V> _link;
+  unsigned int _cursor; // no bucket below this is in use
+  unsigned int _size;
+public:
+  propagation_queue(void) : _cursor(0), _size(0) {}
+
+  bool empty(void) const { return _size == 0; }
+
+  void push(unsigned int k, V v) {
+    if(k >= _head.size()) {
+      _head.resize(k + 1);
+      _bits.resize((k + BITS_PER_WORD) / BITS_PER_WORD,0);
+    }
+    if(v >= _link.size()) { _link.resize(v + 1); }
+    bits_word &w(_bits[k / BITS_PER_WORD]);
+    bits_word b(((bits_word) 1) << (k % BITS_PER_WORD));
+    if(w & b) { _link[v] = _head[k]; } else { _link[v] = v; }
+    w |= b;
+    _head[k] = v;
+    if(_size++ == 0 || k < _cursor) { _cursor = k; }
+  }
+
+  V pop(void) {
+    unsigned int nwords(0);
+    unsigned int k(bits_find(&_bits[0],NULL,_cursor,_head.size(),nwords));
+#ifdef PROPAGATE_GENERATE_STATS
+    prop_nwords += nwords;
+#endif
+    V v(_head[k]);
+    if(_link[v] == v) {
+      _bits[k / BITS_PER_WORD] &= ~(((bits_word) 1) << (k % BITS_PER_WORD));
+    } else {
+      _head[k] = _link[v];
+    }
+    _cursor = k;
+    --_size;
+    return v;
+  }
+};
+
+template<class G, class N2iMap>
+class change_propagation {
+private:
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::out_edge_iterator out_iterator;
+  typedef typename boost::property_traits<N2iMap>::value_type key_t;
+
+  // the nodes which are dirty, or have been queued
+  visit_marks _marked;
+  std::vector<vd_t> _dirty;
+  propagation_queue<key_t,vd_t> _queue;
+public:
+  change_propagation(G const &g) : _marked(num_vertices(g)) {}
+
+  bool dirty(vd_t v) const { return _marked.marked(v); }
+
+  void mark_dirty(vd_t v) {
+    if(!_marked.marked(v)) {
+      _marked.mark(v);
+      _dirty.push_back(v);
+    }
+  }
+
+  // Visit the dirty nodes and those reachable from them, calling
+  // changed(v) on each.  Returns the number of nodes visited.
+
+  template<class F>
+  unsigned int propagate(G const &g, N2iMap n2i, F changed) {
+    unsigned int nvisited(0);
+    for(unsigned int i=0;i!=_dirty.size();++i) {
+      _queue.push(n2i[_dirty[i]],_dirty[i]);
+    }
+    _dirty.clear();
+    while(!_queue.empty()) {
+      vd_t x(_queue.pop());
+      ++nvisited;
+      if(!changed(x)) { continue; }
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(x,g);i!=iend;++i) {
+	vd_t w(target(*i,g));
+	if(!_marked.marked(w)) {
+	  _marked.mark(w);
+	  _queue.push(n2i[w],w);
+	}
+      }
+    }
+    _marked.clear();
+#ifdef PROPAGATE_GENERATE_STATS
+    prop_nvisited += nvisited;
+#endif
+    return nvisited;
+  }
+};
+
+#endif
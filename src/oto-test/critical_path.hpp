@@ -0,0 +1,185 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// Each node has a cost, and the cost of a path is that of its nodes.
+// The critical path is the most costly path in the graph.  For each
+// node v, head[v] is the cost of the most costly path ending at v,
+// and tail[v] that of the most costly path starting at v (both
+// including v).  Then, the most costly path through v costs head[v] +
+// tail[v] - cost[v], and the slack of v is how far short of the
+// critical path this falls.
+//
+// Adding t->h can only raise head for nodes reachable from h, and
+// tail for nodes reaching t.  As for topological_levels, the first
+// are visited lowest n2i first, and the second highest n2i first, so
+// that each is final when it comes off its heap.  Only nodes whose
+// value actually goes up are put on a heap.
+
+#ifndef CRITICAL_PATH_HPP
+#define CRITICAL_PATH_HPP
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <boost/graph/topological_sort.hpp>
+#include "visit_marks.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef CRITICAL_GENERATE_STATS
+extern unsigned int critical_nraised;
+#endif
+
+template<class G, class N2iMap>
+class critical_path {
+private:
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::out_edge_iterator out_iterator;
+  typedef typename G::in_edge_iterator in_iterator;
+
+  // orders a heap lowest n2i first, or highest first if reversed
+  struct heap_comp {
+    N2iMap n2i;
+    bool reversed;
+    heap_comp(N2iMap m, bool r) : n2i(m), reversed(r) {}
+    bool operator()(vd_t a, vd_t b) const {
+      return reversed ? n2i[a] < n2i[b] : n2i[b] < n2i[a];
+    }
+  };
+
+  std::vector<unsigned int> _cost;
+  std::vector<unsigned int> _head;
+  std::vector<unsigned int> _tail;
+  unsigned int _length;
+  visit_marks _queued;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _heap;
+  std::vector<vd_t> _order;
+public:
+  critical_path(G const &g, std::vector<unsigned int> const &cost)
+    : _cost(cost), _length(0), _queued(num_vertices(g)) {
+    recompute(g);
+  }
+
+  unsigned int cost(vd_t v) const { return _cost[v]; }
+
+  // the cost of the critical path
+  unsigned int length(void) const { return _length; }
+
+  unsigned int head(vd_t v) const { return _head[v]; }
+
+  unsigned int tail(vd_t v) const { return _tail[v]; }
+
+  unsigned int slack(vd_t v) const {
+    return _length - (_head[v] + _tail[v] - _cost[v]);
+  }
+
+  // Work out everything from scratch, in O(V+E)
+  // time.  The graph must be acyclic.
+
+  void recompute(G const &g) {
+    _order.clear();
+    topological_sort(g,std::back_inserter(_order));
+    _head.assign(num_vertices(g),0);
+    _tail.assign(num_vertices(g),0);
+    _length = 0;
+    // the sort leaves the nodes in reverse order
+    for(typename std::vector<vd_t>::reverse_iterator i(_order.rbegin());
+	i!=_order.rend();++i) {
+      unsigned int c(0);
+      in_iterator j,jend;
+      for(tie(j,jend) = in_edges(*i,g);j!=jend;++j) {
+	c = std::max(c,_head[source(*j,g)]);
+      }
+      _head[*i] = c + _cost[*i];
+      _length = std::max(_length,_head[*i]);
+    }
+    for(typename std::vector<vd_t>::iterator i(_order.begin());
+	i!=_order.end();++i) {
+      unsigned int c(0);
+      out_iterator j,jend;
+      for(tie(j,jend) = out_edges(*i,g);j!=jend;++j) {
+	c = std::max(c,_tail[target(*j,g)]);
+      }
+      _tail[*i] = c + _cost[*i];
+    }
+  }
+
+  // Call once t->h has been added, and the order
+  // (given by n2i) brought up to date.
+
+  void edge_added(vd_t t, vd_t h, G const &g, N2iMap n2i) {
+    std::vector<vd_t> &heap(_heap);
+
+    // first, the heads forwards from h ...
+    if(_head[t] + _cost[h] > _head[h]) {
+      heap_comp comp(n2i,false);
+      heap.clear();
+      _queued.clear();
+      _head[h] = _head[t] + _cost[h];
+      _queued.mark(h);
+      heap.push_back(h);
+      while(!heap.empty()) {
+	vd_t x(heap.front());
+	std::pop_heap(heap.begin(),heap.end(),comp);
+	heap.pop_back();
+	_length = std::max(_length,_head[x]);
+#ifdef CRITICAL_GENERATE_STATS
+	++critical_nraised;
+#endif
+	out_iterator i,iend;
+	for(tie(i,iend) = out_edges(x,g);i!=iend;++i) {
+	  vd_t w(target(*i,g));
+	  if(_head[w] < _head[x] + _cost[w]) {
+	    _head[w] = _head[x] + _cost[w];
+	    if(!_queued.marked(w)) {
+	      _queued.mark(w);
+	      heap.push_back(w);
+	      std::push_heap(heap.begin(),heap.end(),comp);
+	    }
+	  }
+	}
+      }
+    }
+
+    // ... then the tails backwards from t
+    if(_tail[h] + _cost[t] > _tail[t]) {
+      heap_comp comp(n2i,true);
+      heap.clear();
+      _queued.clear();
+      _tail[t] = _tail[h] + _cost[t];
+      _queued.mark(t);
+      heap.push_back(t);
+      while(!heap.empty()) {
+	vd_t x(heap.front());
+	std::pop_heap(heap.begin(),heap.end(),comp);
+	heap.pop_back();
+#ifdef CRITICAL_GENERATE_STATS
+	++critical_nraised;
+#endif
+	in_iterator i,iend;
+	for(tie(i,iend) = in_edges(x,g);i!=iend;++i) {
+	  vd_t w(source(*i,g));
+	  if(_tail[w] < _tail[x] + _cost[w]) {
+	    _tail[w] = _tail[x] + _cost[w];
+	    if(!_queued.marked(w)) {
+	      _queued.mark(w);
+	      heap.push_back(w);
+	      std::push_heap(heap.begin(),heap.end(),comp);
+	    }
+	  }
+	}
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,265 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// This answers "would adding u->v create a cycle?" without changing
+// anything.  It would iff v reaches u.  Since the order is valid, a
+// path from v to u can only pass through nodes w with n2i[v] <= n2i[w]
+// <= n2i[u].  So, if n2i[u] < n2i[v] the answer is no straight away,
+// and otherwise it is the bounded forward search of MNR, from v up to
+// n2i[u].  Only n2i is needed, so this works with any of the online
+// topological orders (including SCC, where a component shares one
+// index and so u and v may have the same one).
+//
+// The graph and n2i are only read, and all of the scratch space is in
+// the cycle_query object.  So, several threads may ask at once, so
+// long as each has its own cycle_query and nothing is being inserted
+// meanwhile.
+//
+// When many candidate edges are asked about together, the searches
+// from up to 64 different heads are done as one.  Each node gets a
+// 64-bit mask of the heads known to reach it, and the nodes are swept
+// once in order of n2i, from the lowest head up to the highest tail,
+// with each passing its mask on to its successors.  So, a node
+// reached from several heads is only visited once for them all.  A
+// head is dropped from the sweep once it has passed the highest of
+// its tails, and the sweep stops when every head has been dropped.
+// Since nodes are taken in order, the sweep needs a heap rather than
+// a stack.  Under SCC, a node may be given more heads after it has
+// been taken, by another member of its component, in which case it
+// is simply taken again.
+
+#ifndef CYCLE_QUERY_HPP
+#define CYCLE_QUERY_HPP
+
+#include <algorithm>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/property_map.hpp>
+#include "visit_marks.hpp"
+
+template<class G, class N2iMap>
+class cycle_query {
+private:
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::out_edge_iterator out_iterator;
+  typedef typename boost::property_traits<N2iMap>::value_type key_t;
+
+  struct query_t {
+    vd_t u;
+    vd_t v;
+    unsigned int index; // where it was asked
+
+    query_t(vd_t a, vd_t b, unsigned int i) : u(a), v(b), index(i) {}
+  };
+
+  // orders the queries by head
+  struct query_comp {
+    bool operator()(query_t const &a, query_t const &b) const {
+      return a.v < b.v;
+    }
+  };
+
+  // orders the sweep's heap so that the lowest node comes first
+  struct sweep_comp {
+    N2iMap n2i;
+
+    sweep_comp(N2iMap m) : n2i(m) {}
+
+    bool operator()(vd_t a, vd_t b) const {
+      return n2i[b] < n2i[a];
+    }
+  };
+
+  // a head of the sweep, with the highest of its tails
+  struct head_t {
+    vd_t v;
+    vd_t ub;
+    unsigned int bit;
+
+    head_t(vd_t a, vd_t b, unsigned int i) : v(a), ub(b), bit(i) {}
+  };
+
+  // orders the heads by the highest of their tails
+  struct head_comp {
+    N2iMap n2i;
+
+    head_comp(N2iMap m) : n2i(m) {}
+
+    bool operator()(head_t const &a, head_t const &b) const {
+      return n2i[a.ub] < n2i[b.ub];
+    }
+  };
+
+  visit_marks _visited;
+  visit_marks _targets; // the tails being looked for
+  visit_marks _queued;  // nodes on the sweep's heap
+  unsigned int _nvisited;
+  // the heads known to reach each node in the sweep
+  std::vector<boost::uint64_t> _heads;
+  // scratch space, kept between queries
+  // so that they don't need to allocate.
+  std::vector<vd_t> _stack;
+  std::vector<query_t> _batch;
+  std::vector<head_t> _round;
+public:
+  cycle_query(G const &g)
+    : _visited(num_vertices(g)), _targets(num_vertices(g)),
+      _queued(num_vertices(g)), _nvisited(0), _heads(num_vertices(g),0) {
+  }
+
+  // the number of nodes visited so far
+  unsigned int nvisited(void) const { return _nvisited; }
+
+  bool would_create_cycle(vd_t u, vd_t v, G const &g, N2iMap n2i) {
+    if(u == v) {
+      return true;
+    } else if(n2i[u] < n2i[v]) {
+      return false;
+    }
+    _targets.clear();
+    _targets.mark(u);
+    return search(v,n2i[u],1,g,n2i) == 0;
+  }
+
+  // Answer the queries in [b,e), each a pair (u,v) standing for the
+  // edge u->v.  answers[i] is set if the i'th would create a cycle.
+
+  template<class InputIter>
+  void would_create_cycles(InputIter b, InputIter e, G const &g, N2iMap n2i,
+			   std::vector<bool> &answers) {
+    std::vector<query_t> &batch(_batch);
+    batch.clear();
+    answers.clear();
+    for(unsigned int i=0;b!=e;++b,++i) {
+      vd_t u(b->first);
+      vd_t v(b->second);
+      answers.push_back(u == v);
+      if(u != v && !(n2i[u] < n2i[v])) {
+	batch.push_back(query_t(u,v,i));
+      }
+    }
+    std::sort(batch.begin(),batch.end(),query_comp());
+
+    // now, one sweep for each 64 heads
+    std::vector<head_t> &round(_round);
+    for(unsigned int i=0,j=0;i!=batch.size();i=j) {
+      round.clear();
+      for(j=i;j!=batch.size() && round.size() != 64;) {
+	vd_t v(batch[j].v);
+	vd_t ub(batch[j].u);
+	for(;j!=batch.size() && batch[j].v == v;++j) {
+	  if(n2i[ub] < n2i[batch[j].u]) { ub = batch[j].u; }
+	}
+	round.push_back(head_t(v,ub,round.size()));
+      }
+      sweep(round,g,n2i);
+      // the heads were given bits in the order of the batch
+      for(unsigned int k=i,l=0;k!=j;++k) {
+	if(k != i && batch[k].v != batch[k-1].v) { ++l; }
+	vd_t u(batch[k].u);
+	answers[batch[k].index] = _visited.marked(u) &&
+	  (_heads[u] & (((boost::uint64_t) 1) << l)) != 0;
+      }
+    }
+  }
+private:
+  // Sweep upwards from the heads of round, leaving in _heads the
+  // mask of those which reach each node marked in _visited.
+
+  void sweep(std::vector<head_t> &round, G const &g, N2iMap n2i) {
+    std::vector<vd_t> &heap(_stack);
+    sweep_comp comp(n2i);
+    heap.clear();
+    _visited.clear();
+    _queued.clear();
+    // the heads still in the sweep, dropped
+    // in order of the highest of their tails.
+    boost::uint64_t live(0);
+    vd_t ub(round[0].ub);
+    for(unsigned int k=0;k!=round.size();++k) {
+      vd_t v(round[k].v);
+      boost::uint64_t bit(((boost::uint64_t) 1) << k);
+      if(!_visited.marked(v)) {
+	_visited.mark(v);
+	_heads[v] = 0;
+      }
+      _heads[v] |= bit;
+      live |= bit;
+      if(n2i[ub] < n2i[round[k].ub]) { ub = round[k].ub; }
+      if(!_queued.marked(v)) {
+	_queued.mark(v);
+	heap.push_back(v);
+	std::push_heap(heap.begin(),heap.end(),comp);
+      }
+    }
+    std::sort(round.begin(),round.end(),head_comp(n2i));
+    unsigned int dropped(0);
+
+    while(!heap.empty() && live != 0) {
+      vd_t x(heap.front());
+      std::pop_heap(heap.begin(),heap.end(),comp);
+      heap.pop_back();
+      _queued.unmark(x);
+      ++_nvisited;
+      for(;dropped != round.size() && n2i[round[dropped].ub] < n2i[x];++dropped) {
+	live &= ~(((boost::uint64_t) 1) << round[dropped].bit);
+      }
+      boost::uint64_t mask(_heads[x] & live);
+      if(mask == 0) { continue; }
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(x,g);i!=iend;++i) {
+	vd_t w(target(*i,g));
+	if(n2i[ub] < n2i[w]) { continue; }
+	if(!_visited.marked(w)) {
+	  _visited.mark(w);
+	  _heads[w] = 0;
+	}
+	if((_heads[w] | mask) != _heads[w]) {
+	  _heads[w] |= mask;
+	  if(!_queued.marked(w)) {
+	    _queued.mark(w);
+	    heap.push_back(w);
+	    std::push_heap(heap.begin(),heap.end(),comp);
+	  }
+	}
+      }
+    }
+  }
+
+private:
+  // Search forwards from v through nodes no higher than ub, until
+  // every target has been found.  Returns the number not found.
+
+  unsigned int search(vd_t v, key_t const &ub, unsigned int ntargets,
+		      G const &g, N2iMap n2i) {
+    std::vector<vd_t> &stack(_stack);
+    stack.clear();
+    _visited.clear();
+    _visited.mark(v);
+    stack.push_back(v);
+    while(!stack.empty() && ntargets > 0) {
+      vd_t x(stack.back());
+      stack.pop_back();
+      ++_nvisited;
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(x,g);i!=iend;++i) {
+	vd_t w(target(*i,g));
+	if(!_visited.marked(w) && !(ub < n2i[w])) {
+	  _visited.mark(w);
+	  if(_targets.marked(w)) { --ntargets; }
+	  stack.push_back(w);
+	}
+      }
+    }
+    return ntargets;
+  }
+};
+
+#endif
@@ -0,0 +1,32 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// One entry on the explicit stack of a depth-first search: the
+// node being visited and how far through its edges we've got.
+// Using these, rather than recursion, means that long chains of
+// nodes can't overflow the call stack.
+
+#ifndef DFS_FRAME_HPP
+#define DFS_FRAME_HPP
+
+#include <utility>
+
+template<class V, class Iterator>
+struct dfs_frame {
+  V v;
+  Iterator i;
+  Iterator iend;
+
+  dfs_frame(V n, std::pair<Iterator,Iterator> const &edges)
+    : v(n), i(edges.first), iend(edges.second) {
+  }
+};
+
+#endif
@@ -10,6 +10,7 @@
 #define DUMMY_ONLINE_TOPOLOGICAL_ORDER_HPP
 
 #include <stdexcept>
+#include "oto_status.hpp"
 
 template<class T, class N2I>
 class dummy_online_topological_order;
@@ -22,6 +23,18 @@ void add_edges(InputIter b, InputIter e,
   }
 }
 
+// no order is kept, so no cycle is ever noticed
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename dummy_online_topological_order<T,N2I>::vertex_descriptor t,
+	     typename dummy_online_topological_order<T,N2I>::vertex_descriptor h,
+	     dummy_online_topological_order<T,N2I> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s == OTO_INSERTED) { add_edge(t,h,static_cast<T&>(g)); }
+  return s;
+}
+
 template<class T, class N2I = n2i_t>
 class dummy_online_topological_order : public T {
 public:
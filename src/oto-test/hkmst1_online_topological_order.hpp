@@ -0,0 +1,335 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// -----
+// This is the two-way "ordered search" from:
+//
+// [1] Bernhard Haeupler, Telikepalli Kavitha, Rogers Mathew, Siddhartha
+//     Sen and Robert E. Tarjan. Incremental cycle detection, topological
+//     ordering, and strong component maintenance. ACM Transactions on
+//     Algorithms, 2012.
+//
+// As for POTO1, inserting an edge t->h with n2i[h] < n2i[t] starts
+// a forward search from h and a backward search from t.  However,
+// the two are interleaved: on each round, the live forward node
+// lowest in the order and the live backward node highest in the
+// order are each scanned.  The search stops as soon as the lowest
+// forward node x is above the highest backward node y, since then
+// every forward node below x and every backward node above x has
+// been scanned.  These are moved to just before x, backward nodes
+// first.  If the forward search runs out first, the forward nodes
+// are moved to just after t instead.
+//
+// Unlike POTO1, the nodes cannot simply swap indices amongst
+// themselves, because the forward nodes must stay below x.  So, as
+// for MNR, the nodes between h and t are shifted along using the
+// inverse map.
+
+#ifndef HKMST1_ONLINE_TOPOLOGICAL_ORDER_HPP
+#define HKMST1_ONLINE_TOPOLOGICAL_ORDER_HPP
+
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <boost/property_map.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef HKMST1_GENERATE_STATS
+extern unsigned int hkmst1_ddxy;
+extern unsigned int hkmst1_ninvalid;
+extern unsigned int hkmst1_ARxy;
+#endif
+
+template<class T, class N2I>
+class hkmst1_online_topological_order;
+
+// Returns true if a cycle is found.  Otherwise, pivot is set to
+// the index the moved nodes are placed in front of.  The search
+// and the reorder only touch the members they use, so G can be
+// any class which has them (HYBRID borrows them too).
+
+template<class T, class N2I, class G>
+bool hkmst1_oto_search(typename T::vertex_descriptor t,
+		       typename T::vertex_descriptor h,
+		       unsigned int &pivot,
+		       typename boost::property_map<T, N2I>::type n2i,
+		       G &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename T::out_edge_iterator out_iterator;
+  typedef typename T::in_edge_iterator in_iterator;
+  typedef std::pair<unsigned int, vd_t> entry_t; // (n2i,node)
+
+  std::vector<entry_t> &fheap(g._fheap); // lowest first
+  std::vector<entry_t> &bheap(g._bheap); // highest first
+  std::greater<entry_t> fcomp;
+  std::less<entry_t> bcomp;
+  unsigned int lb(n2i[h]);
+  unsigned int ub(n2i[t]);
+
+  fheap.clear();
+  bheap.clear();
+  g._fmarks.clear();
+  g._bmarks.clear();
+  g._fmarks.mark(h);
+  g._bmarks.mark(t);
+  fheap.push_back(entry_t(lb,h));
+  bheap.push_back(entry_t(ub,t));
+
+  while(!fheap.empty() && !bheap.empty() &&
+	fheap.front().first < bheap.front().first) {
+    // scan the lowest live forward node
+    vd_t x(fheap.front().second);
+    std::pop_heap(fheap.begin(),fheap.end(),fcomp);
+    fheap.pop_back();
+#ifdef HKMST1_GENERATE_STATS
+    ++hkmst1_ddxy;
+#endif
+    out_iterator i,iend;
+    for(tie(i,iend) = out_edges(x,g);i!=iend;++i) {
+      vd_t w(target(*i,g));
+#ifdef HKMST1_GENERATE_STATS
+      ++hkmst1_ddxy;
+#endif
+      if(g._bmarks.marked(w)) {
+	// the two searches have met,
+	// so there must be a cycle.
+	return true;
+      } else if(n2i[w] < ub && !g._fmarks.marked(w)) {
+	g._fmarks.mark(w);
+	fheap.push_back(entry_t(n2i[w],w));
+	std::push_heap(fheap.begin(),fheap.end(),fcomp);
+      }
+    }
+
+    // scan the highest live backward node
+    vd_t y(bheap.front().second);
+    std::pop_heap(bheap.begin(),bheap.end(),bcomp);
+    bheap.pop_back();
+#ifdef HKMST1_GENERATE_STATS
+    ++hkmst1_ddxy;
+#endif
+    in_iterator j,jend;
+    for(tie(j,jend) = in_edges(y,g);j!=jend;++j) {
+      vd_t w(source(*j,g));
+#ifdef HKMST1_GENERATE_STATS
+      ++hkmst1_ddxy;
+#endif
+      if(g._fmarks.marked(w)) {
+	return true;
+      } else if(n2i[w] > lb && !g._bmarks.marked(w)) {
+	g._bmarks.mark(w);
+	bheap.push_back(entry_t(n2i[w],w));
+	std::push_heap(bheap.begin(),bheap.end(),bcomp);
+      }
+    }
+  }
+
+  if(fheap.empty()) {
+    pivot = ub + 1;
+  } else {
+    pivot = fheap.front().first;
+  }
+  return false;
+}
+
+// Move the scanned forward nodes below pivot, and the scanned
+// backward nodes above it, to just before pivot.  Live nodes
+// never lie in these ranges, so the marks alone say which nodes
+// move.  The nodes are collected in order as they are passed,
+// so no sorting is needed.
+
+template<class T, class N2I, class G>
+void hkmst1_oto_reorder(unsigned int lb, unsigned int ub, unsigned int pivot,
+			typename boost::property_map<T, N2I>::type n2i,
+			G &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  std::vector<vd_t> &fnodes(g._fnodes);
+  std::vector<vd_t> &bnodes(g._bnodes);
+  fnodes.clear();
+  bnodes.clear();
+
+  // close the gaps below the pivot ...
+  unsigned int k(lb);
+  for(unsigned int i=lb;i<pivot;++i) {
+    vd_t w(g._i2n[i]);
+    if(g._fmarks.marked(w)) {
+      fnodes.push_back(w);
+    } else {
+      g._i2n[k]=w;
+      n2i[w]=k++;
+    }
+  }
+  // ... and those above it
+  unsigned int j(ub);
+  for(unsigned int i=ub+1;i-- > pivot;) {
+    vd_t w(g._i2n[i]);
+    if(g._bmarks.marked(w)) {
+      bnodes.push_back(w);
+    } else {
+      g._i2n[j]=w;
+      n2i[w]=j--;
+    }
+  }
+  // now fill in the space left
+  for(typename std::vector<vd_t>::reverse_iterator i(bnodes.rbegin());
+      i!=bnodes.rend();++i) {
+    g._i2n[k]=*i;
+    n2i[*i]=k++;
+  }
+  for(typename std::vector<vd_t>::iterator i(fnodes.begin());
+      i!=fnodes.end();++i) {
+    g._i2n[k]=*i;
+    n2i[*i]=k++;
+  }
+}
+
+// Bring the order up to date once t->h has gone into the
+// underlying graph.  Returns false, leaving the order as
+// it was, if t->h closes a cycle.
+
+template<class T, class N2I>
+bool hkmst1_oto_insert(typename T::vertex_descriptor t,
+		       typename T::vertex_descriptor h,
+		       hkmst1_online_topological_order<T,N2I> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  unsigned int hn2i(n2i[h]);
+  unsigned int tn2i(n2i[t]);
+
+  if(hn2i < tn2i) {
+    unsigned int pivot;
+    if(hkmst1_oto_search<T,N2I>(t,h,pivot,n2i,g)) {
+      return false;
+    }
+    hkmst1_oto_reorder<T,N2I>(hn2i,tn2i,pivot,n2i,g);
+#ifdef HKMST1_GENERATE_STATS
+    ++hkmst1_ninvalid;
+    hkmst1_ARxy += (tn2i - hn2i + 1);
+#endif
+  }
+  return true;
+}
+
+template<class T, class N2I>
+std::pair<typename T::edge_descriptor, bool>
+add_edge(typename hkmst1_online_topological_order<T,N2I>::vertex_descriptor t,
+	 typename hkmst1_online_topological_order<T,N2I>::vertex_descriptor h,
+	 hkmst1_online_topological_order<T,N2I> &g) {
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(t),
+	       static_cast<typename T::vertex_descriptor>(h),
+	       static_cast<T&>(g));
+
+  if(r.second && !hkmst1_oto_insert<T,N2I>(t,h,g)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename hkmst1_online_topological_order<T,N2I>::vertex_descriptor t,
+	     typename hkmst1_online_topological_order<T,N2I>::vertex_descriptor h,
+	     hkmst1_online_topological_order<T,N2I> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!hkmst1_oto_insert<T,N2I>(t,h,g)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+template<class InputIter, class T, class N2I>
+void add_edges(InputIter b, InputIter e,
+	       hkmst1_online_topological_order<T,N2I> &g) {
+  for(;b!=e;++b) {
+    add_edge(b->first,b->second,g);
+  }
+}
+
+template<class T, class N2I = n2i_t>
+class hkmst1_online_topological_order : public T {
+public:
+  typedef hkmst1_online_topological_order<T,N2I> self;
+  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor,
+								  typename self::vertex_descriptor,
+								  self &);
+  friend bool hkmst1_oto_search<T,N2I>(typename self::vertex_descriptor t,
+				       typename self::vertex_descriptor h,
+				       unsigned int &pivot,
+				       typename boost::property_map<T, N2I>::type n2i,
+				       self &g);
+  friend void hkmst1_oto_reorder<T,N2I>(unsigned int lb, unsigned int ub,
+					unsigned int pivot,
+					typename boost::property_map<T, N2I>::type n2i,
+					self &g);
+  friend bool hkmst1_oto_insert<T,N2I>(typename self::vertex_descriptor t,
+				       typename self::vertex_descriptor h,
+				       self &g);
+private:
+  typedef typename T::vertex_descriptor vd_t;
+
+  std::vector<vd_t> _i2n;
+  visit_marks _fmarks;
+  visit_marks _bmarks;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<std::pair<unsigned int, vd_t> > _fheap;
+  std::vector<std::pair<unsigned int, vd_t> > _bheap;
+  std::vector<vd_t> _fnodes;
+  std::vector<vd_t> _bnodes;
+public:
+  hkmst1_online_topological_order(T const &g, unsigned int acc = 1)
+    : T(g), _i2n(num_vertices(g)), _fmarks(num_vertices(g)),
+      _bmarks(num_vertices(g)) {
+
+    // use the topological sort function to
+    // order the vertices correctly ...
+    std::vector<unsigned int> tmp;
+    tmp.reserve(num_vertices(g));
+    topological_sort(g,std::back_inserter(tmp));
+    // finally, setup the n2i map correctly
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),*this);
+
+    unsigned int index(0);
+    for(std::vector<unsigned int>::reverse_iterator i(tmp.rbegin());i!=tmp.rend();
+	++i,++index) {
+      n2i[*i]=index;
+      _i2n[index]=*i;
+    }
+  }
+
+  hkmst1_online_topological_order(typename T::vertices_size_type n,
+				  unsigned int acc = 1)
+    : T(n), _i2n(n), _fmarks(n), _bmarks(n) {
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),*this);
+
+    unsigned int counter(0);
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      _i2n[counter]=*i;
+      n2i[*i]=counter++;
+    }
+  }
+};
+
+#endif
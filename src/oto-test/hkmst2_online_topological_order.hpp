@@ -0,0 +1,395 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// This is the "soft-threshold search" from:
+//
+// [1] Bernhard Haeupler, Telikepalli Kavitha, Rogers Mathew, Siddhartha
+//     Sen and Robert E. Tarjan. Incremental cycle detection, topological
+//     ordering, and strong component maintenance. ACM Transactions on
+//     Algorithms, 2012.
+//
+// As for HKMST1, inserting an edge v->w which is out of order starts
+// a forward search from w and a backward search from v, which are
+// interleaved one edge at a time.  But, rather than always picking
+// the lowest forward node and the highest backward node (which needs
+// a heap), any pair u,z with u < z may be stepped.  The nodes which
+// are not are set aside (made passive) using a threshold s: forward
+// nodes above it and backward nodes below it.  Once one side has no
+// active nodes left, the passive nodes of the other side are dropped,
+// and a new threshold is chosen from the passive nodes on this side.
+// Here, the median is used rather than a random choice.
+//
+// Once the search stops, let t be the lowest forward node with edges
+// still to be searched (or v, if there is none).  The backward nodes
+// above t, followed by the forward nodes below t, are moved to just
+// before t (or just after v).
+//
+// Like AHRSZ, the order is kept as priorities from an ordered list.
+// Since the list is singly linked, moving k nodes before t is done
+// by inserting k new priorities after t, and then shuffling them
+// along so that t gets the last one.  The priorities left behind
+// are simply never used again.
+
+#ifndef HKMST2_ONLINE_TOPOLOGICAL_ORDER_HPP
+#define HKMST2_ONLINE_TOPOLOGICAL_ORDER_HPP
+
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <boost/property_map.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include "ordered_slist2.hpp"
+#include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+#include "ahrsz_online_topological_order.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef HKMST2_GENERATE_STATS
+extern unsigned int hkmst2_ninvalid;
+extern unsigned int hkmst2_ddxy;
+extern unsigned int hkmst2_K;
+#endif
+
+template<class T, class PSPACE, class N2I>
+class hkmst2_online_topological_order;
+
+template<class T, class PSPACE, class N2I>
+std::pair<typename T::edge_descriptor, bool>
+add_edge(typename hkmst2_online_topological_order<T,PSPACE,N2I>::vertex_descriptor v,
+	 typename hkmst2_online_topological_order<T,PSPACE,N2I>::vertex_descriptor w,
+	 hkmst2_online_topological_order<T,PSPACE,N2I> &g) {
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(v),
+	       static_cast<typename T::vertex_descriptor>(w),
+	       static_cast<T&>(g));
+  if(r.second && !g.insert(v,w)) {
+    remove_edge(v,w,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
+
+template<class T, class PSPACE, class N2I>
+oto_status
+try_add_edge(typename hkmst2_online_topological_order<T,PSPACE,N2I>::vertex_descriptor v,
+	     typename hkmst2_online_topological_order<T,PSPACE,N2I>::vertex_descriptor w,
+	     hkmst2_online_topological_order<T,PSPACE,N2I> &g) {
+  oto_status s(oto_check(v,w,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(v,w,static_cast<T&>(g));
+  if(!g.insert(v,w)) {
+    remove_edge(v,w,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+template<class InputIter, class T, class P, class N2I>
+void add_edges(InputIter b, InputIter e,
+	       hkmst2_online_topological_order<T,P,N2I> &g) {
+  for(;b!=e;++b) {
+    add_edge(b->first,b->second,g);
+  }
+}
+
+template<class T, class PSPACE = ordered_slist2<void>, class N2I = n2i_t>
+class hkmst2_online_topological_order : public T {
+public:
+  typedef hkmst2_online_topological_order<T,PSPACE,N2I> self;
+  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor,
+								  typename self::vertex_descriptor,
+								  self &);
+  friend oto_status try_add_edge<T>(typename self::vertex_descriptor,
+				    typename self::vertex_descriptor,
+				    self &);
+private:
+  typedef typename self::vertex_descriptor vd_t;
+  typedef typename T::out_edge_iterator out_iterator;
+  typedef typename T::in_edge_iterator in_iterator;
+  typedef typename boost::property_map<T, N2I>::type n2i_t;
+  typedef ahrsz_priority_comp<T,N2I,std::less<ahrsz_priority_value<PSPACE> > > priority_comp;
+
+  PSPACE _pspace; // the priority space.
+  // the forward (F) and backward (B) nodes, and
+  // how far through its edges each has got.
+  visit_marks _fmarks;
+  visit_marks _bmarks;
+  std::vector<std::pair<out_iterator,out_iterator> > _fedges;
+  std::vector<std::pair<in_iterator,in_iterator> > _bedges;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _F;
+  std::vector<vd_t> _B;
+  std::vector<vd_t> _FA, _FP; // active and passive forward nodes
+  std::vector<vd_t> _BA, _BP; // active and passive backward nodes
+  std::vector<vd_t> _moved;
+  std::vector<typename PSPACE::iterator> _slots;
+public:
+  hkmst2_online_topological_order(T const &g, unsigned int a = 1)
+    : T(g), _pspace(std::max<size_t>(num_vertices(g),1)),
+      _fmarks(num_vertices(g)), _bmarks(num_vertices(g)),
+      _fedges(num_vertices(g)), _bedges(num_vertices(g)) {
+    // use the topological sort function to
+    // order the vertices correctly ...
+    std::vector<vd_t> tmp;
+    tmp.reserve(num_vertices(g));
+    topological_sort(g,std::back_inserter(tmp));
+    std::reverse(tmp.begin(),tmp.end());
+    // ... and give them priorities in turn.
+    assign(tmp);
+  }
+
+  hkmst2_online_topological_order(typename T::vertices_size_type n, unsigned int a = 1)
+    : T(n), _pspace(std::max<size_t>(n,1)), _fmarks(n), _bmarks(n),
+      _fedges(n), _bedges(n) {
+    std::vector<vd_t> tmp;
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      tmp.push_back(*i);
+    }
+    assign(tmp);
+  }
+
+  hkmst2_online_topological_order(hkmst2_online_topological_order const &src) {
+    copy(src);
+  }
+
+  void operator=(hkmst2_online_topological_order const &src) {
+    if(&src != this) {
+      copy(src);
+    }
+  }
+protected:
+
+  // Bring the order up to date once v->w has gone into the
+  // underlying graph.  Returns false, leaving the order as it
+  // was, if v->w closes a cycle (the search changes nothing).
+
+  bool insert(vd_t v, vd_t w) {
+    n2i_t n2i(get(N2I(),*this));
+    if(n2i[w] < n2i[v]) {
+      if(search(v,w)) { return false; }
+      reorder(v);
+#ifdef HKMST2_GENERATE_STATS
+      ++hkmst2_ninvalid;
+#endif
+    }
+    return true;
+  }
+
+  // --------------------------
+  // the soft-threshold search
+  // --------------------------
+
+  // returns true if a cycle is found
+  bool search(vd_t v, vd_t w) {
+    n2i_t n2i(get(N2I(),*this));
+    _F.clear(); _B.clear();
+    _FA.clear(); _FP.clear();
+    _BA.clear(); _BP.clear();
+    _fmarks.clear();
+    _bmarks.clear();
+    add_forward(w);
+    add_backward(v);
+    vd_t s(w); // the threshold
+
+    while(!_FA.empty() && !_BA.empty()) {
+      vd_t u(_FA.back());
+      vd_t z(_BA.back());
+      if(_fedges[u].first == _fedges[u].second) {
+	// u is finished
+	_FA.pop_back();
+      } else if(_bedges[z].first == _bedges[z].second) {
+	// z is finished
+	_BA.pop_back();
+      } else if(n2i[u] < n2i[z]) {
+	// search one edge either way
+	vd_t x(target(*_fedges[u].first++,*this));
+	vd_t y(source(*_bedges[z].first++,*this));
+#ifdef HKMST2_GENERATE_STATS
+	hkmst2_ddxy += 2;
+#endif
+	if(_bmarks.marked(x) || _fmarks.marked(y) || x == y) {
+	  return true;
+	}
+	if(!_fmarks.marked(x)) { add_forward(x); }
+	if(!_bmarks.marked(y)) { add_backward(y); }
+      } else {
+	// put aside those on the wrong side
+	// of the threshold.
+	if(n2i[s] < n2i[u]) {
+	  _FA.pop_back();
+	  _FP.push_back(u);
+	}
+	if(n2i[z] < n2i[s]) {
+	  _BA.pop_back();
+	  _BP.push_back(z);
+	}
+      }
+
+      if(_FA.empty()) {
+	// the backward nodes at or below the
+	// threshold can no longer matter.
+	_BP.clear();
+	drop_below(_BA,s,n2i);
+	if(!_FP.empty()) { s = split(_FP,_FA,n2i,true); }
+      } else if(_BA.empty()) {
+	_FP.clear();
+	drop_above(_FA,s,n2i);
+	if(!_BP.empty()) { s = split(_BP,_BA,n2i,false); }
+      }
+    }
+    return false;
+  }
+
+  // --------------------------
+  // the reordering
+  // --------------------------
+
+  void reorder(vd_t v) {
+    n2i_t n2i(get(N2I(),*this));
+    priority_comp comp(n2i);
+
+    // find the pivot
+    vd_t t(v);
+    for(typename std::vector<vd_t>::iterator i(_F.begin());i!=_F.end();++i) {
+      if(_fedges[*i].first != _fedges[*i].second && n2i[*i] < n2i[t]) {
+	t = *i;
+      }
+    }
+
+    std::vector<vd_t> &moved(_moved);
+    moved.clear();
+    for(typename std::vector<vd_t>::iterator i(_B.begin());i!=_B.end();++i) {
+      if(n2i[t] < n2i[*i]) { moved.push_back(*i); }
+    }
+    std::sort(moved.begin(),moved.end(),comp);
+    unsigned int nback(moved.size());
+    for(typename std::vector<vd_t>::iterator i(_F.begin());i!=_F.end();++i) {
+      if(n2i[*i] < n2i[t]) { moved.push_back(*i); }
+    }
+    std::sort(moved.begin()+nback,moved.end(),comp);
+#ifdef HKMST2_GENERATE_STATS
+    hkmst2_K += moved.size();
+#endif
+
+    if(t == v) {
+      // everything goes just after v
+      typename PSPACE::iterator p(n2i[v].base());
+      for(typename std::vector<vd_t>::iterator i(moved.begin());i!=moved.end();++i) {
+	p = _pspace.insert_after(p);
+	n2i[*i] = ahrsz_priority_value<PSPACE>(p,_pspace);
+      }
+    } else if(!moved.empty()) {
+      // everything goes just before t, so make
+      // room after it and then shuffle along.
+      std::vector<typename PSPACE::iterator> &slots(_slots);
+      slots.clear();
+      typename PSPACE::iterator p(n2i[t].base());
+      slots.push_back(p);
+      for(unsigned int k=0;k!=moved.size();++k) {
+	p = _pspace.insert_after(p);
+	slots.push_back(p);
+      }
+      for(unsigned int k=0;k!=moved.size();++k) {
+	n2i[moved[k]] = ahrsz_priority_value<PSPACE>(slots[k],_pspace);
+      }
+      n2i[t] = ahrsz_priority_value<PSPACE>(slots.back(),_pspace);
+    }
+  }
+private:
+  void add_forward(vd_t x) {
+    _fmarks.mark(x);
+    _fedges[x] = out_edges(x,*this);
+    _F.push_back(x);
+    _FA.push_back(x);
+  }
+
+  void add_backward(vd_t y) {
+    _bmarks.mark(y);
+    _bedges[y] = in_edges(y,*this);
+    _B.push_back(y);
+    _BA.push_back(y);
+  }
+
+  // drop the nodes at or below s
+  void drop_below(std::vector<vd_t> &nodes, vd_t s, n2i_t n2i) {
+    unsigned int k(0);
+    for(unsigned int i=0;i!=nodes.size();++i) {
+      if(n2i[s] < n2i[nodes[i]]) { nodes[k++] = nodes[i]; }
+    }
+    nodes.resize(k);
+  }
+
+  // drop the nodes at or above s
+  void drop_above(std::vector<vd_t> &nodes, vd_t s, n2i_t n2i) {
+    unsigned int k(0);
+    for(unsigned int i=0;i!=nodes.size();++i) {
+      if(n2i[nodes[i]] < n2i[s]) { nodes[k++] = nodes[i]; }
+    }
+    nodes.resize(k);
+  }
+
+  // Choose the median of the passive nodes as the new threshold,
+  // and make those on the near side of it active again.  For the
+  // forward search, these are the ones at or below it.
+
+  vd_t split(std::vector<vd_t> &passive, std::vector<vd_t> &active,
+	     n2i_t n2i, bool forward) {
+    priority_comp comp(n2i);
+    typename std::vector<vd_t>::iterator mid(passive.begin() + passive.size()/2);
+    std::nth_element(passive.begin(),mid,passive.end(),comp);
+    vd_t s(*mid);
+    if(forward) {
+      active.assign(passive.begin(),mid+1);
+      passive.erase(passive.begin(),mid+1);
+    } else {
+      active.assign(mid,passive.end());
+      passive.erase(mid,passive.end());
+    }
+    return s;
+  }
+
+  // give the nodes priorities in the order given
+  void assign(std::vector<vd_t> const &order) {
+    n2i_t n2i(get(N2I(),*this));
+    typename PSPACE::iterator p(_pspace.begin());
+    for(typename std::vector<vd_t>::const_iterator i(order.begin());
+	i!=order.end();++i,++p) {
+      n2i[*i] = ahrsz_priority_value<PSPACE>(p,_pspace);
+    }
+  }
+
+  void copy(hkmst2_online_topological_order const &src) {
+    // invoke super assignment operator
+    T::operator=(src);
+    unsigned int n(num_vertices(*this));
+    _fmarks = visit_marks(n);
+    _bmarks = visit_marks(n);
+    _fedges.resize(n);
+    _bedges.resize(n);
+
+    // the priorities still refer to src, so
+    // use them to sort the nodes first.
+    std::vector<vd_t> tmp;
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      tmp.push_back(*i);
+    }
+    std::sort(tmp.begin(),tmp.end(),priority_comp(get(N2I(),*this)));
+    _pspace = PSPACE(std::max<size_t>(n,1));
+    assign(tmp);
+  }
+};
+
+#endif
@@ -0,0 +1,374 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// No one algorithm does best everywhere.  MNR is good when the
+// affected region (the window between h and t) is small, POTO1 when
+// the nodes which must move are spread thinly across a wide window,
+// and AHRSZ when they are very few.  This picks between them on each
+// invalidating edge, using one graph and one order (the n2i map plus
+// its inverse).  AHRSZ cannot share an integer order, so its place is
+// taken by the ordered search of HKMST1, which likewise only visits
+// the nodes which must move.  The searches and reorders are those of
+// the three algorithms themselves, so this class keeps the members
+// they use under the same names.
+//
+// The choice is made from things that are cheap to find out:
+//
+// 1. A small window always goes to MNR, since shifting it costs
+//    little, and MNR has no sorting or heaps.
+//
+// 2. If h has no successors, there is nothing to search and MNR only
+//    has to shift the window.
+//
+// 3. If t has no predecessors, the backward search of POTO1 finds
+//    only t, so POTO1 does the same search as MNR but then moves
+//    just the nodes found, rather than the whole window.
+//
+// 4. Otherwise, the work done (edges and nodes visited, plus nodes
+//    moved) is divided by the width of the window, and this rate is
+//    averaged over the last few insertions given to each strategy.
+//    The strategy with the lowest rate wins.  Every so often, the
+//    strategy unused for longest is tried, so that none of the
+//    averages can go stale.
+
+#ifndef HYBRID_ONLINE_TOPOLOGICAL_ORDER_HPP
+#define HYBRID_ONLINE_TOPOLOGICAL_ORDER_HPP
+
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <boost/property_map.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include <boost/cstdint.hpp>
+#include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+#include "dfs_frame.hpp"
+#include "work_budget.hpp"
+#include "mnr_online_topological_order.hpp"
+#include "poto1_online_topological_order.hpp"
+#include "hkmst1_online_topological_order.hpp"
+
+#define HYBRID_MNR 0
+#define HYBRID_POTO1 1
+#define HYBRID_HKMST1 2
+#define HYBRID_NSTRATEGIES 3
+
+// windows no wider than this always go to MNR
+#define HYBRID_SMALL_WINDOW 32
+// how often the least recently used strategy is tried
+#define HYBRID_EXPLORE 64
+// weight given to the latest rate in the averages
+#define HYBRID_DECAY 0.125
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef HYBRID_GENERATE_STATS
+extern unsigned int hybrid_ninvalid;
+extern unsigned int hybrid_ddxy;
+extern unsigned int hybrid_nselected[HYBRID_NSTRATEGIES];
+#endif
+
+template<class T, class N2I>
+class hybrid_online_topological_order;
+
+template<class T, class N2I>
+std::pair<typename T::edge_descriptor, bool>
+add_edge(typename hybrid_online_topological_order<T,N2I>::vertex_descriptor t,
+	 typename hybrid_online_topological_order<T,N2I>::vertex_descriptor h,
+	 hybrid_online_topological_order<T,N2I> &g) {
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(t),
+	       static_cast<typename T::vertex_descriptor>(h),
+	       static_cast<T&>(g));
+  if(r.second && !g.insert(t,h)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename hybrid_online_topological_order<T,N2I>::vertex_descriptor t,
+	     typename hybrid_online_topological_order<T,N2I>::vertex_descriptor h,
+	     hybrid_online_topological_order<T,N2I> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!g.insert(t,h)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+template<class InputIter, class T, class N2I>
+void add_edges(InputIter b, InputIter e,
+	       hybrid_online_topological_order<T,N2I> &g) {
+  for(;b!=e;++b) {
+    add_edge(b->first,b->second,g);
+  }
+}
+
+template<class T, class N2I = n2i_t>
+class hybrid_online_topological_order : public T {
+public:
+  typedef hybrid_online_topological_order<T,N2I> self;
+  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor,
+								  typename self::vertex_descriptor,
+								  self &);
+  friend oto_status try_add_edge<T>(typename self::vertex_descriptor,
+				    typename self::vertex_descriptor,
+				    self &);
+  friend bool mnr_oto_dfs<T,N2I>(typename T::vertex_descriptor, unsigned int, unsigned int,
+				 typename boost::property_map<T, N2I>::type &,
+				 self &, std::vector<typename T::vertex_descriptor> *);
+  friend void mnr_oto_shift<T,N2I>(unsigned int, unsigned int,
+				   typename boost::property_map<T, N2I>::type &,
+				   self &);
+  friend bool poto1_oto_fwd_dfs<T,N2I>(typename self::vertex_descriptor,
+				       typename self::vertex_descriptor,
+				       std::vector<unsigned int> &,
+				       typename boost::property_map<T, N2I>::type,
+				       self &, std::vector<typename T::vertex_descriptor> *);
+  friend void poto1_oto_back_dfs<T,N2I>(typename self::vertex_descriptor,
+					typename self::vertex_descriptor,
+					std::vector<unsigned int> &,
+					typename boost::property_map<T, N2I>::type,
+					self &);
+  friend void poto1_oto_reorder<T,N2I>(std::vector<boost::uint64_t> const &,
+				       std::vector<boost::uint64_t> const &,
+				       typename boost::property_map<T, N2I>::type,
+				       self &);
+  friend bool hkmst1_oto_search<T,N2I>(typename self::vertex_descriptor,
+				       typename self::vertex_descriptor,
+				       unsigned int &,
+				       typename boost::property_map<T, N2I>::type,
+				       self &);
+  friend void hkmst1_oto_reorder<T,N2I>(unsigned int, unsigned int, unsigned int,
+					typename boost::property_map<T, N2I>::type,
+					self &);
+private:
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename boost::property_map<T, N2I>::type n2i_map;
+  typedef std::pair<unsigned int, vd_t> entry_t; // (n2i,node)
+
+  std::vector<vd_t> _i2n;
+  // the history of each strategy
+  double _rate[HYBRID_NSTRATEGIES];
+  unsigned int _last[HYBRID_NSTRATEGIES];
+  bool _tried[HYBRID_NSTRATEGIES];
+  unsigned int _ninvalid;
+  bool _learning; // was the last choice made from the history?
+  // The state of each algorithm's search and reorder, kept between
+  // insertions so that they don't need to allocate.  The budget is
+  // never configured, so it only measures the work MNR does, and the
+  // parallel search is never turned on.
+  visit_marks _visited; // by index for MNR, by node for POTO1
+  work_budget _budget;
+  par_bounded_search<T,n2i_map> _par;
+  std::vector<vd_t> _worklist;
+  std::vector<vd_t> _tmp;
+  std::vector<vd_t> _parent;
+  visit_marks _backvisited;
+  std::vector<dfs_frame<vd_t,typename T::out_edge_iterator> > _fwdstack;
+  std::vector<dfs_frame<vd_t,typename T::in_edge_iterator> > _backstack;
+  int _cancel; // set by the forward search, read with __atomic
+  unsigned int _fwdwork;
+  unsigned int _backvisits;
+  std::vector<unsigned int> _reaching;
+  std::vector<unsigned int> _reachable;
+  std::vector<boost::uint64_t> _reachingkeys;
+  std::vector<boost::uint64_t> _reachablekeys;
+  std::vector<boost::uint64_t> _keybuf;
+  visit_marks _fmarks;
+  visit_marks _bmarks;
+  std::vector<entry_t> _fheap;
+  std::vector<entry_t> _bheap;
+  std::vector<vd_t> _fnodes;
+  std::vector<vd_t> _bnodes;
+public:
+  hybrid_online_topological_order(T const &g, unsigned int acc = 1)
+    : T(g), _i2n(num_vertices(g)), _visited(num_vertices(g)),
+      _backvisited(num_vertices(g)), _cancel(0), _fmarks(num_vertices(g)),
+      _bmarks(num_vertices(g)) {
+    reset_history();
+
+    // use the topological sort function to
+    // order the vertices correctly ...
+    std::vector<unsigned int> tmp;
+    tmp.reserve(num_vertices(g));
+    topological_sort(g,std::back_inserter(tmp));
+    // finally, setup the n2i map correctly
+    n2i_map n2i = get(N2I(),*this);
+
+    unsigned int index(0);
+    for(std::vector<unsigned int>::reverse_iterator i(tmp.rbegin());i!=tmp.rend();
+	++i,++index) {
+      n2i[*i]=index;
+      _i2n[index]=*i;
+    }
+  }
+
+  hybrid_online_topological_order(typename T::vertices_size_type n,
+				  unsigned int acc = 1)
+    : T(n), _i2n(n), _visited(n), _backvisited(n), _cancel(0),
+      _fmarks(n), _bmarks(n) {
+    reset_history();
+    n2i_map n2i = get(N2I(),*this);
+
+    unsigned int counter(0);
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      _i2n[counter]=*i;
+      n2i[*i]=counter++;
+    }
+  }
+protected:
+  // Bring the order up to date once t->h has gone into the
+  // underlying graph.  Each strategy searches before moving
+  // anything, so on a cycle the order is left as it was.
+
+  bool insert(vd_t t, vd_t h) {
+    n2i_map n2i = get(N2I(),*this);
+    unsigned int lb(n2i[h]);
+    unsigned int ub(n2i[t]);
+    if(lb >= ub) { return true; }
+    unsigned int s(select(t,h,lb,ub));
+    unsigned int work(0);
+    bool cycle;
+    switch(s) {
+    case HYBRID_MNR:
+      cycle = mnr(t,h,lb,ub,work);
+      break;
+    case HYBRID_POTO1:
+      cycle = poto1(t,h,lb,ub,work);
+      break;
+    default:
+      cycle = hkmst1(t,h,lb,ub,work);
+      break;
+    }
+    record(s,work,ub-lb+1);
+    if(cycle) { return false; }
+#ifdef HYBRID_GENERATE_STATS
+    ++hybrid_ninvalid;
+    ++hybrid_nselected[s];
+    hybrid_ddxy += work;
+#endif
+    return true;
+  }
+
+  unsigned int select(vd_t t, vd_t h, unsigned int lb, unsigned int ub) {
+    ++_ninvalid;
+    _learning = false;
+    if(ub - lb < HYBRID_SMALL_WINDOW || out_degree(h,*this) == 0) {
+      return HYBRID_MNR;
+    } else if(in_degree(t,*this) == 0) {
+      return HYBRID_POTO1;
+    }
+    _learning = true;
+    unsigned int best(0);
+    if(_ninvalid % HYBRID_EXPLORE == 0) {
+      for(unsigned int s=1;s!=HYBRID_NSTRATEGIES;++s) {
+	if(_last[s] < _last[best]) { best = s; }
+      }
+      return best;
+    }
+    for(unsigned int s=0;s!=HYBRID_NSTRATEGIES;++s) {
+      if(!_tried[s]) { return s; }
+      if(_rate[s] < _rate[best]) { best = s; }
+    }
+    return best;
+  }
+
+  void record(unsigned int s, unsigned int work, unsigned int width) {
+    // only insertions which could have gone to any
+    // strategy are comparable.
+    if(!_learning) { return; }
+    double rate(((double) work) / width);
+    if(_tried[s]) {
+      _rate[s] += HYBRID_DECAY * (rate - _rate[s]);
+    } else {
+      _rate[s] = rate;
+      _tried[s] = true;
+    }
+    _last[s] = _ninvalid;
+  }
+
+  // MNR: search forwards from h, then shift the window
+  // along so that the nodes found come just after t.
+
+  bool mnr(vd_t, vd_t h, unsigned int lb, unsigned int ub,
+	   unsigned int &work) {
+    n2i_map n2i = get(N2I(),*this);
+    _budget.start(num_vertices(*this),num_edges(*this));
+    if(mnr_oto_dfs<T,N2I>(h,lb,ub,n2i,*this,NULL)) { return true; }
+    mnr_oto_shift<T,N2I>(lb,ub,n2i,*this);
+    work += _budget.spent() + ub - lb + 1;
+    return false;
+  }
+
+  // POTO1: search both ways, and then hand out the indices
+  // of the nodes found amongst themselves.
+
+  bool poto1(vd_t t, vd_t h, unsigned int lb, unsigned int ub,
+	     unsigned int &work) {
+    n2i_map n2i = get(N2I(),*this);
+    _reaching.clear();
+    _reachable.clear();
+    _visited.clear();
+    _budget.start(num_vertices(*this),num_edges(*this));
+    if(poto1_oto_fwd_dfs<T,N2I>(h,ub,_reachable,n2i,*this,NULL)) {
+      return true;
+    }
+    poto1_oto_back_dfs<T,N2I>(t,lb,_reaching,n2i,*this);
+    poto1_oto_sort(_reaching,lb,ub,n2i,_reachingkeys,_keybuf);
+    poto1_oto_sort(_reachable,lb,ub,n2i,_reachablekeys,_keybuf);
+    poto1_oto_reorder<T,N2I>(_reachablekeys,_reachingkeys,n2i,*this);
+    work += _fwdwork + _backvisits + _reaching.size() + _reachable.size();
+    return false;
+  }
+
+  // HKMST1: the ordered search, then a shift of the nodes
+  // scanned to either side of where the two searches crossed.
+
+  bool hkmst1(vd_t t, vd_t h, unsigned int lb, unsigned int ub,
+	      unsigned int &work) {
+    n2i_map n2i = get(N2I(),*this);
+    unsigned int pivot;
+    if(hkmst1_oto_search<T,N2I>(t,h,pivot,n2i,*this)) { return true; }
+    hkmst1_oto_reorder<T,N2I>(lb,ub,pivot,n2i,*this);
+    // the nodes moved are the ones scanned,
+    // so their edges give the work of the search.
+    work += ub - lb + 1;
+    for(unsigned int i=0;i!=_fnodes.size();++i) {
+      work += 1 + out_degree(_fnodes[i],*this);
+    }
+    for(unsigned int i=0;i!=_bnodes.size();++i) {
+      work += 1 + in_degree(_bnodes[i],*this);
+    }
+    return false;
+  }
+private:
+  void reset_history(void) {
+    for(unsigned int s=0;s!=HYBRID_NSTRATEGIES;++s) {
+      _rate[s] = 0;
+      _last[s] = 0;
+      _tried[s] = false;
+    }
+    _ninvalid = 0;
+    _learning = false;
+  }
+};
+
+#endif
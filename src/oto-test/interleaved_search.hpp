@@ -0,0 +1,333 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// Runs several independent depth-first searches at once, so that
+// the cache misses of one search can be overlapped with the work
+// of the others.  Each search (or "lane") is a little state
+// machine with an explicit stack, and the lanes are stepped in
+// round-robin fashion.  The memory latency is hidden with a two
+// stage pipeline:
+//
+//   1) when a node is chosen for visiting, its vertex record is
+//      prefetched and the lane yields;
+//
+//   2) when the lane next runs, the node is entered and the
+//      records of all its successors are prefetched.  Again, the
+//      lane yields, so that by the time it scans the successors
+//      they should be in the cache.
+//
+// The vertex record is found through the n2i property map, since
+// the property lives alongside the edge lists in each vertex.
+//
+// The direction of a search, and how its bound is interpreted, is
+// given by a small policy class (see isearch_forward, etc below).
+// A lane may be given several roots, which are searched one after
+// the other, and the nodes found are reported in post-order along
+// with the bound of the root they were found from.
+//
+// Normally all lanes share one set of visit marks, which is fine
+// when the lanes are known to visit disjoint sets of nodes.  If
+// not, each lane may be given its own marks instead.
+//
+// Optionally, a lane can also be stopped when it meets an edge back
+// to a node still on its stack.  This is needed when the graph may
+// contain a cycle which does not pass through the bound.  The marks
+// for this are always shared, so the lanes must be disjoint.
+
+#ifndef INTERLEAVED_SEARCH_HPP
+#define INTERLEAVED_SEARCH_HPP
+
+#include <vector>
+#include <utility>
+#include "visit_marks.hpp"
+#include "dfs_frame.hpp"
+
+// the number of searches run together
+// when interleaving is turned on.
+#define ISEARCH_DEFAULT_LANES 8
+
+#if __GNUC__ >= 3
+#define ISEARCH_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define ISEARCH_PREFETCH(p)
+#endif
+
+// the outcome of examining a successor
+#define ISEARCH_IGNORE 0
+#define ISEARCH_VISIT 1
+#define ISEARCH_STOP 2
+
+// search forwards from the root, visiting nodes w with
+// n2i[w] < bound and stopping if n2i[w] == bound.
+
+template<class G>
+struct isearch_forward {
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::out_edge_iterator iterator;
+
+  static std::pair<iterator,iterator> edges(vd_t v, G const &g) {
+    return out_edges(v,g);
+  }
+
+  static vd_t next(iterator i, G const &g) {
+    return target(*i,g);
+  }
+
+  template<class N2iMap>
+  static int classify(vd_t w, unsigned int bound, N2iMap &n2i) {
+    unsigned int wn2i(n2i[w]);
+    if(wn2i == bound) {
+      return ISEARCH_STOP;
+    } else if(wn2i < bound) {
+      return ISEARCH_VISIT;
+    }
+    return ISEARCH_IGNORE;
+  }
+};
+
+// search backwards from the root, visiting nodes w with
+// n2i[w] > bound.
+
+template<class G>
+struct isearch_backward {
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::in_edge_iterator iterator;
+
+  static std::pair<iterator,iterator> edges(vd_t v, G const &g) {
+    return in_edges(v,g);
+  }
+
+  static vd_t next(iterator i, G const &g) {
+    return source(*i,g);
+  }
+
+  template<class N2iMap>
+  static int classify(vd_t w, unsigned int bound, N2iMap &n2i) {
+    return n2i[w] > bound ? ISEARCH_VISIT : ISEARCH_IGNORE;
+  }
+};
+
+// search forwards from the root without any bound, stopping
+// when the node given as the bound is reached.
+
+template<class G>
+struct isearch_path {
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::out_edge_iterator iterator;
+
+  static std::pair<iterator,iterator> edges(vd_t v, G const &g) {
+    return out_edges(v,g);
+  }
+
+  static vd_t next(iterator i, G const &g) {
+    return target(*i,g);
+  }
+
+  template<class N2iMap>
+  static int classify(vd_t w, unsigned int bound, N2iMap &) {
+    return w == bound ? ISEARCH_STOP : ISEARCH_VISIT;
+  }
+};
+
+template<class G, class N2iMap, class DIR>
+class interleaved_search {
+public:
+  typedef typename G::vertex_descriptor vd_t;
+  typedef std::pair<unsigned int, vd_t> found_t; // (bound,node)
+private:
+  typedef typename DIR::iterator iterator;
+  typedef dfs_frame<vd_t,iterator> frame;
+
+  struct lane {
+    std::vector<std::pair<vd_t,unsigned int> > roots;
+    unsigned int next_root;
+    unsigned int bound;  // bound of the current root
+    std::vector<frame> stack;
+    std::vector<found_t> found;
+    visit_marks marks;   // only used if not shared
+    vd_t staged;         // node prefetched but not yet entered
+    bool has_staged;
+    bool stopped;
+    unsigned int nvisits;
+  };
+
+  std::vector<lane> _lanes;
+  unsigned int _nused;
+  bool _shared;
+  bool _cycle_check;
+  visit_marks _marks;
+  visit_marks _onstack;  // only used if checking for cycles
+  G const *_g;
+  N2iMap _n2i;
+public:
+  interleaved_search(unsigned int nlanes = ISEARCH_DEFAULT_LANES,
+		     bool shared = true)
+    : _lanes(nlanes), _nused(0), _shared(shared), _cycle_check(false),
+      _g(NULL) {
+  }
+
+  // stop a lane on an edge back to a node on its stack
+  void set_cycle_check(bool on) { _cycle_check = on; }
+
+  // maximum number of lanes
+  unsigned int capacity(void) const { return _lanes.size(); }
+
+  // number of lanes in use
+  unsigned int size(void) const { return _nused; }
+
+  bool full(void) const { return _nused == _lanes.size(); }
+
+  void set_capacity(unsigned int nlanes) {
+    _lanes.resize(nlanes);
+    _nused = 0;
+  }
+
+  // forget all lanes, and unmark everything
+  void reset(G const &g, N2iMap n2i) {
+    unsigned int n(num_vertices(g));
+    _g = &g;
+    _n2i = n2i;
+    for(unsigned int k=0;k!=_nused;++k) {
+      lane &l(_lanes[k]);
+      l.roots.clear();
+      l.stack.clear();
+      l.found.clear();
+      if(!_shared) { l.marks.clear(); }
+    }
+    _nused = 0;
+    if(_cycle_check) {
+      if(_onstack.size() < n) { _onstack.resize(n); }
+      _onstack.clear();
+    }
+    if(_shared) {
+      if(_marks.size() < n) { _marks.resize(n); }
+      _marks.clear();
+    } else {
+      for(unsigned int k=0;k!=_lanes.size();++k) {
+	if(_lanes[k].marks.size() < n) { _lanes[k].marks.resize(n); }
+      }
+    }
+  }
+
+  // start a new lane, returning its index.
+  unsigned int add_lane(void) {
+    lane &l(_lanes[_nused]);
+    l.next_root = 0;
+    l.has_staged = false;
+    l.stopped = false;
+    l.nvisits = 0;
+    return _nused++;
+  }
+
+  // roots are searched in the order they are added, and
+  // a root already visited by the lane is skipped.
+  void add_root(unsigned int k, vd_t root, unsigned int bound) {
+    _lanes[k].roots.push_back(std::make_pair(root,bound));
+  }
+
+  // run all the lanes to completion
+  void run(void) {
+    unsigned int active(_nused);
+    while(active > 0) {
+      for(unsigned int k=0;k!=_nused;++k) {
+	lane &l(_lanes[k]);
+	if(!l.stopped && !step(l)) {
+	  l.stopped = true;
+	  --active;
+	}
+      }
+    }
+  }
+
+  // did lane k stop early (i.e. find a cycle, or
+  // reach the target of a path query)?
+  bool stopped_early(unsigned int k) const {
+    lane const &l(_lanes[k]);
+    return !l.stack.empty() || l.has_staged;
+  }
+
+  std::vector<found_t> const &found(unsigned int k) const {
+    return _lanes[k].found;
+  }
+
+  unsigned int nvisits(unsigned int k) const {
+    return _lanes[k].nvisits;
+  }
+private:
+  visit_marks &marks(lane &l) {
+    return _shared ? _marks : l.marks;
+  }
+
+  // advance lane l by one step.  Returns
+  // false when the lane has finished.
+  bool step(lane &l) {
+    G const &g(*_g);
+    visit_marks &m(marks(l));
+
+    if(l.has_staged) {
+      // stage two: enter the node and prefetch
+      // the records of its successors.
+      frame f(l.staged,DIR::edges(l.staged,g));
+      for(iterator j(f.i);j!=f.iend;++j) {
+	ISEARCH_PREFETCH(&_n2i[DIR::next(j,g)]);
+      }
+      l.stack.push_back(f);
+      if(_cycle_check) { _onstack.mark(l.staged); }
+      l.has_staged = false;
+      ++l.nvisits;
+      return true;
+    }
+
+    if(l.stack.empty()) {
+      // start on the next root
+      while(l.next_root < l.roots.size()) {
+	std::pair<vd_t,unsigned int> r(l.roots[l.next_root++]);
+	if(!m.marked(r.first)) {
+	  m.mark(r.first);
+	  l.bound = r.second;
+	  stage(l,r.first);
+	  return true;
+	}
+      }
+      return false;
+    }
+
+    frame &f(l.stack.back());
+    while(f.i != f.iend) {
+      vd_t w(DIR::next(f.i,g));
+      ++f.i;
+      ++l.nvisits;
+      int c(DIR::classify(w,l.bound,_n2i));
+      if(c == ISEARCH_STOP) {
+	return false;
+      } else if(c == ISEARCH_VISIT && _cycle_check && _onstack.marked(w)) {
+	return false;
+      } else if(c == ISEARCH_VISIT && !m.marked(w)) {
+	m.mark(w);
+	stage(l,w);
+	return true;
+      }
+    }
+    // all successors done
+    l.found.push_back(found_t(l.bound,f.v));
+    if(_cycle_check) { _onstack.unmark(f.v); }
+    l.stack.pop_back();
+    return true;
+  }
+
+  // stage one: prefetch the node's record
+  void stage(lane &l, vd_t w) {
+    ISEARCH_PREFETCH(&_n2i[w]);
+    l.staged = w;
+    l.has_staged = true;
+  }
+};
+
+#endif
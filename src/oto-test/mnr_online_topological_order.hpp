@@ -23,6 +23,12 @@
 #include <boost/property_map.hpp>
 #include <boost/graph/topological_sort.hpp>
 #include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "parallel_reachability.hpp"
+#include "parallel_topological_sort.hpp"
+#include "visit_marks.hpp"
+#include "interleaved_search.hpp"
+#include "work_budget.hpp"
 
 #ifdef MNR_GENERATE_STATS
 extern unsigned int mnr_ARxy;
@@ -34,27 +40,62 @@ extern unsigned int algo_count;
 template<class T, class N2I, class I2NMAP>
 class mnr_online_topological_order;
 
-template<class T, class N2I, class I2NMAP> 
+// If cycle is given, a parent is recorded for each node found,
+// and on reaching ub cycle is set to the path found from h.
+//
+// The search and the shift below only need the members they use,
+// so G can be any class which has them (HYBRID borrows them too).
+
+template<class T, class N2I, class G> 
 bool mnr_oto_dfs(typename T::vertex_descriptor h, unsigned int lb,
 		 unsigned int ub,
 		 typename boost::property_map<T, N2I>::type &n2i, 
-		 mnr_online_topological_order<T,N2I,I2NMAP> &g) {
+		 G &g,
+		 std::vector<typename T::vertex_descriptor> *cycle) {
 
   // some useful typedefs
 
   typedef typename T::vertex_descriptor vd_t;
   typedef typename T::out_edge_iterator oiterator;
 
+  // forget the previous search
+
+  g._visited.clear();
+
+  // large affected regions are
+  // searched in parallel.
+
+  if(cycle == NULL && g._par.active(ub - lb)) {
+    g._budget.lift();
+    std::vector<vd_t> &reachable(g._worklist);
+    unsigned int nvisits(0);
+    reachable.clear();
+    bool cycle(g._par.search(h,ub,g,n2i,reachable,nvisits));
+#ifdef MNR_GENERATE_STATS
+    mnr_ddfxy += nvisits;
+    algo_count += nvisits;
+#endif
+    for(typename std::vector<vd_t>::iterator i(reachable.begin());
+	i!=reachable.end();++i) {
+      g._visited.mark(n2i[*i]);
+    }
+    return cycle;
+  }
+
   // now the actual code.
-  // create worklist and guess at
+  // reuse worklist and guess at
   // likely max size
 
-  std::vector<vd_t> worklist;    
+  std::vector<vd_t> &worklist(g._worklist);
+  worklist.clear();
   worklist.reserve((ub - lb) + 1);
+  if(cycle != NULL && g._parent.size() < num_vertices(g)) {
+    g._parent.resize(num_vertices(g));
+  }
 
   // mark node h as visited
   
-  g._visited[lb]=true;
+  g._visited.mark(lb);
   worklist.push_back(h);
 
   // now perform the depth-first-search
@@ -62,6 +103,10 @@ bool mnr_oto_dfs(typename T::vertex_descriptor h, unsigned int lb,
   while(worklist.size() > 0) { 
     vd_t n(worklist.back());
     worklist.pop_back();
+    if(!g._budget.charge(1 + out_degree(n,g))) {
+      // give up, the caller will re-sort.
+      return false;
+    }
 #ifdef MNR_GENERATE_STATS
     ++mnr_ddfxy;
     ++algo_count;
@@ -73,9 +118,14 @@ bool mnr_oto_dfs(typename T::vertex_descriptor h, unsigned int lb,
       if(wn2i == ub) {
 	// this is the special case
 	// where a cycle has been detected
+	if(cycle != NULL) {
+	  oto_witness(h,n,g._parent,*cycle);
+	  cycle->push_back(target(*i,g));
+	}
 	return true;
-      } else if(wn2i < ub && !g._visited[wn2i]) {
-	g._visited[wn2i]=true;
+      } else if(wn2i < ub && !g._visited.marked(wn2i)) {
+	g._visited.mark(wn2i);
+	if(cycle != NULL) { g._parent[target(*i,g)] = n; }
 	worklist.push_back(target(*i,g));
       }
 #ifdef MNR_GENERATE_STATS
@@ -87,11 +137,11 @@ bool mnr_oto_dfs(typename T::vertex_descriptor h, unsigned int lb,
   return false;
 }
 
-template<class T, class N2I, class I2NMAP>
+template<class T, class N2I, class G>
 void mnr_oto_shift(unsigned int lb, 
 		   unsigned int ub,  
 		   typename boost::property_map<T, N2I>::type &n2i, 
-		   mnr_online_topological_order<T,N2I,I2NMAP> &g) {    
+		   G &g) {    
 
   // some useful typedefs
 
@@ -100,17 +150,17 @@ void mnr_oto_shift(unsigned int lb,
   // the body
 
   unsigned int shift(0);
-  std::vector<vd_t> tmp; // temporary storage 
+  std::vector<vd_t> &tmp(g._tmp); // temporary storage 
+  tmp.clear();
   unsigned int i;
   for(i=lb;i<=ub;++i) {
 #ifdef MNR_GENERATE_STATS
     ++algo_count;
 #endif
     vd_t w(g._i2n[i]);
-    if(g._visited[i]) {
+    if(g._visited.marked(i)) {
       tmp.push_back(w);
       ++shift;
-      g._visited[i]=false;
     } else {
       g._i2n[i-shift]=w;
       n2i[w]=i-shift;	
@@ -127,6 +177,65 @@ void mnr_oto_shift(unsigned int lb,
   }
 }
 
+// Sort the whole graph again, when a search has gone over budget.
+// Returns false, leaving the order alone, if there is a cycle.
+
+template<class T, class N2I, class I2NMAP>
+bool mnr_oto_resort(typename boost::property_map<T, N2I>::type &n2i, 
+		    mnr_online_topological_order<T,N2I,I2NMAP> &g) {
+  unsigned int cost;
+  if(!offline_topological_sort(static_cast<T const &>(g),g._order,g._sortmarks,
+			       g._done,g._sortstack,cost)) {
+    return false;
+  }
+  for(unsigned int i=0;i!=g._order.size();++i) {
+    g._i2n[i]=g._order[i];
+    n2i[g._order[i]]=i;
+  }
+  g._budget.fallback(cost);
+#ifdef MNR_GENERATE_STATS
+  mnr_ddfxy += cost;
+  algo_count += cost;
+#endif
+  return true;
+}
+
+// Bring the order up to date once t->h has gone into the
+// underlying graph.  Returns false, leaving the order as
+// it was, if t->h closes a cycle (which is put in cycle,
+// if given).
+
+template<class T, class N2I, class I2NMAP>
+bool mnr_oto_insert(typename T::vertex_descriptor t, 
+		    typename T::vertex_descriptor h, 
+		    mnr_online_topological_order<T,N2I,I2NMAP> &g,
+		    std::vector<typename T::vertex_descriptor> *cycle) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  unsigned int hn2i(n2i[h]);
+  unsigned int tn2i(n2i[t]);
+
+  if(hn2i < tn2i) {
+    // need to reorder
+    g._budget.start(num_vertices(g),num_edges(g));
+    if(cycle != NULL) { g._budget.lift(); }
+    if(mnr_oto_dfs<T,N2I>(h,hn2i,tn2i,n2i,g,cycle)) {
+      return false;
+    } else if(g._budget.exceeded()) {
+      if(!mnr_oto_resort(n2i,g)) { return false; }
+    } else {
+      mnr_oto_shift<T,N2I>(hn2i,tn2i,n2i,g);
+      g._budget.completed(tn2i - hn2i + 1);
+    }
+#ifdef MNR_GENERATE_STATS
+    ++mnr_ninvalid;
+    mnr_ARxy += (tn2i - hn2i + 1);
+#endif
+  }
+  return true;
+}
+
 template<class T, class N2I, class I2NMAP>
 std::pair<typename T::edge_descriptor, bool> 
 add_edge(typename mnr_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor t, 
@@ -138,31 +247,152 @@ add_edge(typename mnr_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor
 	       static_cast<typename T::vertex_descriptor>(h),
 	       static_cast<T&>(g));
 
-  typedef typename boost::property_map<T, N2I>::type N2iMap;
-  N2iMap n2i = get(N2I(),g);
+  if(r.second && !mnr_oto_insert<T,N2I,I2NMAP>(t,h,g,NULL)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
 
-  unsigned int hn2i(n2i[h]);
-  unsigned int tn2i(n2i[t]);
+template<class T, class N2I, class I2NMAP>
+oto_status
+try_add_edge(typename mnr_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor t, 
+	     typename mnr_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor h, 
+	     mnr_online_topological_order<T,N2I,I2NMAP> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!mnr_oto_insert<T,N2I,I2NMAP>(t,h,g,NULL)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
 
-  if(r.second && hn2i < tn2i) {
-    // need to reorder
-    if(mnr_oto_dfs<T,N2I,I2NMAP>(h,hn2i,tn2i,n2i,g)) {
+template<class T, class N2I, class I2NMAP>
+oto_status
+try_add_edge(typename mnr_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor t, 
+	     typename mnr_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor h, 
+	     mnr_online_topological_order<T,N2I,I2NMAP> &g,
+	     std::vector<typename T::vertex_descriptor> &cycle) {
+  cycle.clear();
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s == OTO_CYCLE) { cycle.push_back(h); }
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!mnr_oto_insert<T,N2I,I2NMAP>(t,h,g,&cycle)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+// When interleaving is turned on, the searches for a batch are
+// run together.  The invalidating edges are collected until one
+// of them (or any other edge) touches the affected region of an
+// edge already collected.  Since the regions are then disjoint,
+// no search can reach another's edge, and each shift only
+// renumbers its own region.  Hence, the outcome is the same as
+// inserting the edges one at a time.
+
+template<class T, class N2I, class I2NMAP>
+void mnr_oto_flush(typename boost::property_map<T, N2I>::type &n2i, 
+		   mnr_online_topological_order<T,N2I,I2NMAP> &g) {    
+  if(g._windows.empty()) { return; }
+
+  g._isearch.run();
+
+  for(unsigned int k=0;k!=g._windows.size();++k) {
+    unsigned int lb(g._windows[k].first);
+    unsigned int ub(g._windows[k].second);
+#ifdef MNR_GENERATE_STATS
+    mnr_ddfxy += g._isearch.nvisits(k);
+    algo_count += g._isearch.nvisits(k);
+#endif
+    if(g._isearch.stopped_early(k)) {
+      // this edge closes a cycle, and those after it
+      // were never really inserted, so take them all out
+      // again.  Removing by descriptor leaves any parallel
+      // copies that were already present in place.
+      for(unsigned int j=g._inserted.size();j!=g._lanepos[k];--j) {
+	remove_edge(g._inserted[j-1],static_cast<T&>(g));
+      }
+      g._windows.clear();
+      g._lanepos.clear();
+      g._inserted.clear();
       throw std::runtime_error("loop detected");
-    } else {
-      mnr_oto_shift(hn2i,tn2i,n2i,g);
     }
+    g._visited.clear();
+    typename std::vector<std::pair<unsigned int, typename T::vertex_descriptor> >::const_iterator i;
+    for(i=g._isearch.found(k).begin();i!=g._isearch.found(k).end();++i) {
+      g._visited.mark(n2i[i->second]);
+    }
+    mnr_oto_shift<T,N2I>(lb,ub,n2i,g);
 #ifdef MNR_GENERATE_STATS
     ++mnr_ninvalid;
-    mnr_ARxy += (tn2i - hn2i + 1);
+    mnr_ARxy += (ub - lb + 1);
 #endif
   }
+  g._windows.clear();
+  g._lanepos.clear();
+  g._inserted.clear();
+}
+
+template<class T, class N2I, class I2NMAP>
+void mnr_oto_push(typename T::vertex_descriptor t, 
+		  typename T::vertex_descriptor h, 
+		  typename boost::property_map<T, N2I>::type &n2i, 
+		  mnr_online_topological_order<T,N2I,I2NMAP> &g) {
+  unsigned int hn2i(n2i[h]);
+  unsigned int tn2i(n2i[t]);
+
+  // does this edge touch a region already collected?
+  for(unsigned int k=0;k!=g._windows.size();++k) {
+    unsigned int lb(g._windows[k].first);
+    unsigned int ub(g._windows[k].second);
+    if((hn2i >= lb && hn2i <= ub) || (tn2i >= lb && tn2i <= ub) ||
+       (hn2i < tn2i && hn2i <= ub && lb <= tn2i)) {
+      mnr_oto_flush(n2i,g);
+      // the order has changed
+      hn2i = n2i[h];
+      tn2i = n2i[t];
+      break;
+    }
+  }
+
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(t),
+	       static_cast<typename T::vertex_descriptor>(h),
+	       static_cast<T&>(g));
+  if(!r.second) { return; }
+
+  if(hn2i < tn2i) {
+    if(g._windows.empty()) { g._isearch.reset(g,n2i); }
+    unsigned int k(g._isearch.add_lane());
+    g._isearch.add_root(k,h,tn2i);
+    g._windows.push_back(std::make_pair(hn2i,tn2i));
+    g._lanepos.push_back(g._inserted.size());
+  }
+  if(!g._windows.empty()) {
+    g._inserted.push_back(r.first);
+  }
+  if(g._isearch.full()) { mnr_oto_flush(n2i,g); }
 }
 
 template<class InputIter, class T, class N2I, class I2NMAP>
 void add_edges(InputIter b, InputIter e, 
 	       mnr_online_topological_order<T,N2I,I2NMAP> &g) {
-  for(;b!=e;++b) {
-    add_edge(b->first,b->second,g);
+  if(g.lanes() <= 1) {
+    for(;b!=e;++b) {
+      add_edge(b->first,b->second,g);
+    }
+  } else {
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),g);
+    for(;b!=e;++b) {
+      mnr_oto_push<T,N2I,I2NMAP>(b->first,b->second,n2i,g);
+    }
+    mnr_oto_flush<T,N2I,I2NMAP>(n2i,g);
   }
 }
 
@@ -174,19 +404,69 @@ public:
 								 typename self::vertex_descriptor, 
 								 self &);
   
-  friend bool mnr_oto_dfs<>(typename T::vertex_descriptor , unsigned int, unsigned int, 
+  friend bool mnr_oto_dfs<T,N2I>(typename T::vertex_descriptor , unsigned int, unsigned int, 
 			    typename boost::property_map<T, N2I>::type &, 
-			    self &);
+			    self &, std::vector<typename T::vertex_descriptor> *);
   
-  friend void mnr_oto_shift<>(unsigned int, unsigned int, 
+  friend void mnr_oto_shift<T,N2I>(unsigned int, unsigned int, 
 			      typename boost::property_map<T, N2I>::type &, 
 			      self &);
+
+  friend bool mnr_oto_resort<>(typename boost::property_map<T, N2I>::type &, 
+			       self &);
+
+  friend bool mnr_oto_insert<>(typename T::vertex_descriptor, 
+			       typename T::vertex_descriptor, 
+			       self &, std::vector<typename T::vertex_descriptor> *);
+
+  friend void mnr_oto_flush<>(typename boost::property_map<T, N2I>::type &, 
+			      self &);
+
+  friend void mnr_oto_push<>(typename T::vertex_descriptor, 
+			     typename T::vertex_descriptor, 
+			     typename boost::property_map<T, N2I>::type &, 
+			     self &);
 private:
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+
   I2NMAP _i2n;
-  std::vector<bool> _visited;
+  visit_marks _visited;
+  par_bounded_search<T,N2iMap> _par;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<typename T::vertex_descriptor> _worklist;
+  std::vector<typename T::vertex_descriptor> _tmp;
+  std::vector<typename T::vertex_descriptor> _parent; // only for cycles
+  // state for interleaving the searches of a batch
+  interleaved_search<T,N2iMap,isearch_forward<T> > _isearch;
+  std::vector<std::pair<unsigned int, unsigned int> > _windows;
+  std::vector<unsigned int> _lanepos; // lane's edge in _inserted
+  std::vector<typename T::edge_descriptor> _inserted;
+  // state for falling back to an offline sort
+  work_budget _budget;
+  std::vector<typename T::vertex_descriptor> _order;
+  visit_marks _sortmarks;
+  visit_marks _done;
+  std::vector<dfs_frame<typename T::vertex_descriptor,
+			typename T::out_edge_iterator> > _sortstack;
 public:
-  mnr_online_topological_order(T const &g, unsigned int acc = 1) 
-    : T(g), _visited(num_vertices(g),false) {
+  mnr_online_topological_order(T const &g, unsigned int acc = 1,
+			       unsigned int nthreads = 1,
+			       unsigned int threshold = PAR_SORT_DEFAULT_THRESHOLD) 
+    : T(g), _visited(num_vertices(g)), _isearch(1) {
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),*this);
+
+    if(nthreads > 1) {
+      // the parallel sort fills in n2i
+      // itself, and the order into _i2n.
+      par_topological_sort<T> sorter(nthreads,threshold);
+      _i2n.resize(num_vertices(g));
+      if(!sorter.sort(*this,_i2n,n2i)) {
+	throw std::runtime_error("loop detected");
+      }
+      return;
+    }
     
     // use the topological sort function to
     // order the vertices correctly ...
@@ -195,9 +475,6 @@ public:
     // now reverse them
     reverse(_i2n.begin(),_i2n.end());
     // finally, setup the n2i map correctly
-    typedef typename boost::property_map<T, N2I>::type N2iMap;
-    N2iMap n2i = get(N2I(),*this);
-    
     for(unsigned int i=0;i!=_i2n.size();++i) {
       n2i[_i2n[i]]=i;
     }    
@@ -205,7 +482,7 @@ public:
 
   mnr_online_topological_order(typename T::vertices_size_type n,
 			       unsigned int acc = 1) 
-    : T(n), _i2n(n), _visited(n,false) {
+    : T(n), _i2n(n), _visited(n), _isearch(1) {
     typedef typename boost::property_map<T, N2I>::type N2iMap;
     N2iMap n2i = get(N2I(),*this);
     
@@ -216,6 +493,27 @@ public:
       n2i[*i]=counter++;
     }
   }
+
+  // use nthreads threads for forward searches whose
+  // frontier grows beyond threshold nodes.
+  void set_parallel(unsigned int nthreads,
+		    unsigned int threshold = PAR_DEFAULT_THRESHOLD) {
+    _par.configure(nthreads,threshold);
+  }
+
+  // interleave up to nlanes searches when
+  // inserting a batch of edges.
+  void set_lanes(unsigned int nlanes) {
+    _isearch.set_capacity(nlanes);
+  }
+
+  unsigned int lanes(void) const { return _isearch.capacity(); }
+
+  // abandon any search costing more than factor times an
+  // offline sort, and sort offline instead (zero turns off).
+  void set_budget(double factor) {
+    _budget.configure(factor);
+  }
 };
 
 #endif
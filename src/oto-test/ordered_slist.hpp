@@ -236,6 +236,7 @@ public:
     ol_ncreated += _list.size();
 #endif
     }
+    return *this;
   }
 
   template <class InputIterator>
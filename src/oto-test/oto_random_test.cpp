@@ -0,0 +1,308 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// Applies random insertions and removals to a small random DAG,
+// and checks every edge of the graph against the order after each
+// one.  This is much more thorough than the checking in oto_test,
+// which only looks at the order once per batch.
+//
+// Most insertions follow a hidden order of the nodes, so that the
+// graph stays acyclic and keeps on growing.  The rest are between
+// any two nodes, and are made with try_add_edge, so that the paths
+// which turn away an edge closing a cycle are checked too.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <sys/time.h>
+#include <getopt.h>
+
+#include <boost/random.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include "mnr_online_topological_order.hpp"
+#include "poto1_online_topological_order.hpp"
+#include "poto2_online_topological_order.hpp"
+#include "hkmst1_online_topological_order.hpp"
+#include "bfgt_online_topological_order.hpp"
+#include "hkmst2_online_topological_order.hpp"
+#include "bc_online_topological_order.hpp"
+#include "dense_online_topological_order.hpp"
+#include "hybrid_online_topological_order.hpp"
+#include "scc_online_topological_order.hpp"
+#include "ahrsz_online_topological_order.hpp"
+#include "simple_topological_order.hpp"
+
+using namespace std;
+using namespace boost;
+
+#define MAJOR_VERSION 0
+#define MINOR_VERSION 1
+
+#define OPT_HELP 0
+#define OPT_VERSION 1
+#define OPT_NODES 2
+#define OPT_EDGES 3
+#define OPT_OVER 4
+#define OPT_SEED 5
+#define OPT_RUNS 6
+#define OPT_DELETE 7
+#define OPT_ALGORITHM 8
+#define OPT_CYCLES 9
+
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,unsigned int> > subgraph1_t;
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,ahrsz_priority_value<> > > subgraph2_t;
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,ahrsz_priority_value<ordered_slist2<void> > > > subgraph3_t;
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,bfgt_key> > subgraph4_t;
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,bc_key> > subgraph5_t;
+
+typedef poto1_online_topological_order<subgraph1_t> POTO1_graph_t;
+typedef poto2_online_topological_order<subgraph1_t> POTO2_graph_t;
+typedef hkmst1_online_topological_order<subgraph1_t> HKMST1_graph_t;
+typedef bfgt_online_topological_order<subgraph4_t> BFGT_graph_t;
+typedef hkmst2_online_topological_order<subgraph3_t> HKMST2_graph_t;
+typedef bc_online_topological_order<subgraph5_t> BC_graph_t;
+typedef dense_online_topological_order<subgraph1_t> DENSE_graph_t;
+typedef hybrid_online_topological_order<subgraph1_t> HYBRID_graph_t;
+typedef scc_online_topological_order<subgraph1_t> SCC_graph_t;
+typedef mnr_online_topological_order<subgraph1_t> MNR_graph_t;
+typedef ahrsz_online_topological_order<subgraph2_t> AHRSZb_graph_t;
+typedef ahrsz_online_topological_order<subgraph3_t, ordered_slist2<void> > AHRSZ_graph_t;
+typedef simple_topological_order<subgraph1_t> DFS_graph_t;
+
+class my_timer {
+private:
+  struct timeval _start;
+public:
+  my_timer(void) {
+    gettimeofday(&_start,NULL);
+  }
+
+  double elapsed(void) {
+    struct timeval tmp;
+    gettimeofday(&tmp,NULL);
+    double end = tmp.tv_sec + (tmp.tv_usec / 1000000.0);
+    double start = _start.tv_sec + (_start.tv_usec / 1000000.0);
+    return end - start;
+  }
+};
+
+// Is the edge x->y in order?  For SCC, the nodes of a
+// component share an index, so only the components must
+// be in order.
+
+template<class T>
+bool in_order(typename T::vertex_descriptor x, typename T::vertex_descriptor y,
+	      T &g) {
+  return get(n2i_t(),g)[x] < get(n2i_t(),g)[y];
+}
+
+template<class S, class N2I>
+bool in_order(typename S::vertex_descriptor x, typename S::vertex_descriptor y,
+	      scc_online_topological_order<S,N2I> &g) {
+  return !(get(N2I(),g)[y] < get(N2I(),g)[x]);
+}
+
+// Draw a fresh sample for BC from each seed, since
+// which nodes are sampled changes what gets reordered.
+
+template<class T>
+void set_seed(T &graph, unsigned int s) {
+}
+
+template<class S, class N2I>
+void set_seed(bc_online_topological_order<S,N2I> &graph, unsigned int s) {
+  graph.reseed(s);
+}
+
+// Run one test over the given seed, returning
+// false and printing the offending operation
+// if an edge is ever found out of order.
+
+template<class T, class S>
+bool run(string const &name, unsigned int n, unsigned int m,
+	 unsigned int over, unsigned int seed, double pdelete,
+	 double pcycle) {
+  typedef pair<unsigned int, unsigned int> edge_t;
+  boost::mt19937 rgen(seed);
+  boost::random_number_generator<boost::mt19937,unsigned int> rng(rgen);
+  boost::uniform_01<boost::mt19937> coin(rgen);
+
+  // a random DAG, taking the edges along a random permutation
+  vector<unsigned int> perm(n);
+  for(unsigned int i=0;i!=n;++i) { perm[i] = i; }
+  random_shuffle(perm.begin(),perm.end(),rng);
+  S tmp(n);
+  vector<edge_t> present;
+  while(present.size() < m && n > 1) {
+    unsigned int a(rng(n)), b(rng(n));
+    if(a == b) { continue; }
+    if(a > b) { swap(a,b); }
+    if(edge(perm[a],perm[b],tmp).second) { continue; }
+    add_edge(perm[a],perm[b],tmp);
+    present.push_back(edge_t(perm[a],perm[b]));
+  }
+  T graph(tmp);
+  set_seed(graph,seed);
+
+  for(unsigned int op=0;op!=over;++op) {
+    string type;
+    edge_t e;
+    if(!present.empty() && coin() < pdelete) {
+      unsigned int k(rng(present.size()));
+      e = present[k];
+      present[k] = present.back();
+      present.pop_back();
+      remove_edge(e.first,e.second,graph);
+      type = "remove";
+    } else {
+      unsigned int a(rng(n)), b(rng(n));
+      if(a == b) { continue; }
+      if(a > b && coin() >= pcycle) { swap(a,b); }
+      e = edge_t(perm[a],perm[b]);
+      if(try_add_edge(e.first,e.second,graph) == OTO_INSERTED) {
+	present.push_back(e);
+	type = "insert";
+      } else {
+	type = "reject";
+      }
+    }
+    typename T::edge_iterator i,iend;
+    for(tie(i,iend) = edges(graph);i!=iend;++i) {
+      if(!in_order(source(*i,graph),target(*i,graph),graph)) {
+	cout << name << ": failure with seed " << seed << " after op " << op
+	     << " (" << type << " " << e.first << "->" << e.second << "), "
+	     << source(*i,graph) << "->" << target(*i,graph)
+	     << " is out of order" << endl;
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int nodes(40), nedges(60), over(1000), seed(1), runs(100);
+  double pdelete(0), pcycle(0.1);
+  string algorithm;
+
+  struct option long_options[]={
+    {"help",no_argument,NULL,OPT_HELP},
+    {"version",no_argument,NULL,OPT_VERSION},
+    {"nodes",required_argument,NULL,OPT_NODES},
+    {"edges",required_argument,NULL,OPT_EDGES},
+    {"over",required_argument,NULL,OPT_OVER},
+    {"seed",required_argument,NULL,OPT_SEED},
+    {"runs",required_argument,NULL,OPT_RUNS},
+    {"delete",required_argument,NULL,OPT_DELETE},
+    {"algorithm",required_argument,NULL,OPT_ALGORITHM},
+    {"cycles",required_argument,NULL,OPT_CYCLES},
+    NULL
+  };
+
+  char *descriptions[]={
+    " -h     --help                    display this information",
+    " -v     --version                 display version information",
+    " -n<x>  --nodes=<x>               number of nodes in the graph (default=40)",
+    " -e<x>  --edges=<x>               number of edges to start with (default=60)",
+    " -o<x>  --over=<x>                test over x operations (default=1000)",
+    " -s<x>  --seed=<x>                seed of the first run (default=1)",
+    " -r<x>  --runs=<x>                test x runs, with consecutive seeds (default=100)",
+    " -d<x>  --delete=<x>              make a fraction x of the operations removals",
+    " -a<x>  --algorithm=<x>           test only algorithm x (e.g. BC), rather than all",
+    " -c<x>  --cycles=<x>              let a fraction x of the insertions go against the",
+    "                                  hidden order, so they may close a cycle (default=0.1)",
+    NULL
+  };
+
+  char v;
+  while((v=getopt_long(argc,argv,"hvn:e:o:s:r:d:a:c:",long_options,NULL)) != -1) {
+    switch(v)
+      {
+      case 'h':
+      case OPT_HELP:
+	cout << "usage: " << argv[0] << " [options]" << endl;
+	cout << "options:" << endl;
+	for(char **ptr=descriptions;*ptr != NULL; ptr++) {
+	  cout << *ptr << endl;
+	}
+	exit(1);
+      case 'v':
+      case OPT_VERSION:
+	cout << argv[0] << " v" << MAJOR_VERSION << "." << MINOR_VERSION << endl;
+	exit(1);
+      case 'n':
+      case OPT_NODES:
+	nodes = atoi(optarg);
+	break;
+      case 'e':
+      case OPT_EDGES:
+	nedges = atoi(optarg);
+	break;
+      case 'o':
+      case OPT_OVER:
+	over = atoi(optarg);
+	break;
+      case 's':
+      case OPT_SEED:
+	seed = strtoul(optarg,NULL,10);
+	break;
+      case 'r':
+      case OPT_RUNS:
+	runs = atoi(optarg);
+	break;
+      case 'd':
+      case OPT_DELETE:
+	pdelete = atof(optarg);
+	break;
+      case 'a':
+      case OPT_ALGORITHM:
+	algorithm = optarg;
+	break;
+      case 'c':
+      case OPT_CYCLES:
+	pcycle = atof(optarg);
+	break;
+      default:
+	// getopt will print invalid argument for us
+	exit(1);
+      }
+  }
+
+  if(nodes > 1 && nedges > nodes * (nodes-1) / 2) {
+    cout << "too many edges for a DAG on " << nodes << " nodes" << endl;
+    exit(1);
+  }
+
+  my_timer t;
+  bool ok(true);
+  for(unsigned int s=seed;s!=seed+runs && ok;++s) {
+#define RUN(NAME,T,S) \
+    if(ok && (algorithm.empty() || algorithm == NAME)) { \
+      ok = run<T,S>(NAME,nodes,nedges,over,s,pdelete,pcycle); \
+    }
+    RUN("MNR",MNR_graph_t,subgraph1_t);
+    RUN("POTO1",POTO1_graph_t,subgraph1_t);
+    RUN("POTO2",POTO2_graph_t,subgraph1_t);
+    RUN("HKMST1",HKMST1_graph_t,subgraph1_t);
+    RUN("BFGT",BFGT_graph_t,subgraph4_t);
+    RUN("HKMST2",HKMST2_graph_t,subgraph3_t);
+    RUN("BC",BC_graph_t,subgraph5_t);
+    RUN("DENSE",DENSE_graph_t,subgraph1_t);
+    RUN("HYBRID",HYBRID_graph_t,subgraph1_t);
+    RUN("SCC",SCC_graph_t,subgraph1_t);
+    RUN("AHRSZ",AHRSZ_graph_t,subgraph3_t);
+    RUN("AHRSZb",AHRSZb_graph_t,subgraph2_t);
+    RUN("DFS",DFS_graph_t,subgraph1_t);
+#undef RUN
+  }
+  if(!ok) { exit(1); }
+  cout << t.elapsed() << endl;
+}
@@ -0,0 +1,64 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// Every order class has try_add_edge(t,h,g), as well as add_edge.
+// Rather than throwing when t->h would close a cycle, it returns
+// OTO_CYCLE, and the graph and order are left exactly as they were.
+// An edge which is already in the graph is not added again.
+//
+// MNR, POTO1 and AHRSZ also have try_add_edge(t,h,g,cycle).  When t->h
+// is turned away, this sets cycle to a path h,...,t in the graph,
+// which t->h would close.  The searches only keep what is needed for
+// this when they are asked to, and then they are never parallel or
+// cut short by a budget.
+//
+// Edges are taken out with remove_edge(t,h,g).  Removing an edge
+// never makes an order invalid, so the order is simply left as it
+// is.  For most of the classes, there is nothing else to do, and the
+// remove_edge of the underlying graph does it all.  BFGT, BC, DENSE
+// and SCC keep state of their own for each edge, and so have their
+// own remove_edge to bring it up to date.
+
+#ifndef OTO_STATUS_HPP
+#define OTO_STATUS_HPP
+
+#include <algorithm>
+#include <vector>
+#include <boost/graph/graph_traits.hpp>
+
+enum oto_status { OTO_INSERTED, OTO_DUPLICATE, OTO_CYCLE };
+
+// The checks made before t->h goes into the underlying graph g.
+// Returns OTO_INSERTED if the insertion should go ahead.
+
+template<class G>
+oto_status oto_check(typename G::vertex_descriptor t,
+		     typename G::vertex_descriptor h, G const &g) {
+  if(t == h) {
+    return OTO_CYCLE;
+  } else if(edge(t,h,g).second) {
+    return OTO_DUPLICATE;
+  }
+  return OTO_INSERTED;
+}
+
+// Set path to h,...,x, by following parent back from x to h.
+
+template<class V, class P>
+void oto_witness(V h, V x, P const &parent, std::vector<V> &path) {
+  path.clear();
+  for(;x != h;x = parent[x]) {
+    path.push_back(x);
+  }
+  path.push_back(h);
+  std::reverse(path.begin(),path.end());
+}
+
+#endif
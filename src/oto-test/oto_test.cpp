@@ -17,10 +17,12 @@
 #include <iomanip>
 #include <fstream>
 #include <cstdlib>
+#include <cstring>
 #include <getopt.h>
 #include <sys/time.h>
 
 #include <set>
+#include <map>
 #include <vector>
 #include <algorithm>
 #include <numeric>
@@ -33,14 +35,28 @@
 #define AHRSZ_GENERATE_STATS
 #define MNR_GENERATE_STATS
 #define POTO1_GENERATE_STATS
+#define POTO2_GENERATE_STATS
+#define HKMST1_GENERATE_STATS
+#define BFGT_GENERATE_STATS
+#define HKMST2_GENERATE_STATS
+#define BC_GENERATE_STATS
+#define DENSE_GENERATE_STATS
+#define HYBRID_GENERATE_STATS
+#define SCC_GENERATE_STATS
 #define SOTO_GENERATE_STATS
 #define OL_GENERATE_STATS
 #define OL2_GENERATE_STATS
+#define PAR_GENERATE_STATS
+#define BUDGET_GENERATE_STATS
+#define LEVELS_GENERATE_STATS
+#define CRITICAL_GENERATE_STATS
+#define PROPAGATE_GENERATE_STATS
 
 #include <boost/random.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/depth_first_search.hpp>
 #include <boost/graph/copy.hpp>
+#include <boost/graph/strong_components.hpp>
 #include <boost/lexical_cast.hpp>
 #include "stats.hpp"
 #include "range.hpp"
@@ -48,9 +64,50 @@
 #include "path.hpp"
 #include "mnr_online_topological_order.hpp"
 #include "poto1_online_topological_order.hpp"
+#include "poto2_online_topological_order.hpp"
+#include "hkmst1_online_topological_order.hpp"
+#include "bfgt_online_topological_order.hpp"
+#include "hkmst2_online_topological_order.hpp"
+#include "bc_online_topological_order.hpp"
+#include "dense_online_topological_order.hpp"
+#include "hybrid_online_topological_order.hpp"
+#include "scc_online_topological_order.hpp"
 #include "ahrsz_online_topological_order.hpp"
 #include "dummy_online_topological_order.hpp"
 #include "simple_topological_order.hpp"
+#include "topological_levels.hpp"
+#include "critical_path.hpp"
+#include "change_propagation.hpp"
+#include "cycle_query.hpp"
+
+// ----------------------
+// Allocation Counting
+//
+// When --count-allocs is given,
+// every heap allocation made during
+// the timed part of an experiment is
+// counted.
+// ----------------------
+
+bool alloc_counting = false;
+unsigned long nallocs = 0;
+
+void *operator new(size_t size) {
+  if(alloc_counting) { ++nallocs; }
+  void *p = malloc(size == 0 ? 1 : size);
+  if(p == NULL) { throw std::bad_alloc(); }
+  return p;
+}
+
+void operator delete(void *p) throw() {
+  free(p);
+}
+
+// compilers with sized deallocation call this
+// form instead, which must also go to free.
+void operator delete(void *p, size_t) throw() {
+  free(p);
+}
 
 class my_timer {
 private:
@@ -78,8 +135,18 @@ using namespace boost;
 typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,unsigned int> > subgraph1_t;
 typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,ahrsz_priority_value<> > > subgraph2_t;
 typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,ahrsz_priority_value<ordered_slist2<void> > > > subgraph3_t;
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,bfgt_key> > subgraph4_t;
+typedef adjacency_list<vecS,vecS, bidirectionalS, property<n2i_t,bc_key> > subgraph5_t;
 
 typedef poto1_online_topological_order<subgraph1_t> POTO1_graph_t;
+typedef poto2_online_topological_order<subgraph1_t> POTO2_graph_t;
+typedef hkmst1_online_topological_order<subgraph1_t> HKMST1_graph_t;
+typedef bfgt_online_topological_order<subgraph4_t> BFGT_graph_t;
+typedef hkmst2_online_topological_order<subgraph3_t> HKMST2_graph_t;
+typedef bc_online_topological_order<subgraph5_t> BC_graph_t;
+typedef dense_online_topological_order<subgraph1_t> DENSE_graph_t;
+typedef hybrid_online_topological_order<subgraph1_t> HYBRID_graph_t;
+typedef scc_online_topological_order<subgraph1_t> SCC_graph_t;
 typedef mnr_online_topological_order<subgraph1_t> MNR_graph_t;
 typedef ahrsz_online_topological_order<subgraph2_t> AHRSZb_graph_t;
 typedef ahrsz_online_topological_order<subgraph3_t, ordered_slist2<void> > AHRSZ_graph_t;
@@ -112,6 +179,33 @@ typedef dummy_online_topological_order<subgraph1_t> dummy_graph_t;
 #define OPT_INPUT 31
 #define OPT_NGRAPHS 32
 #define OPT_EDGES 33
+#define OPT_THREADS 34
+#define OPT_PARTHRESHOLD 35
+#define OPT_COUNTALLOCS 36
+#define OPT_LANES 37
+#define OPT_CHAIN 38
+#define OPT_CONCURRENT 39
+#define OPT_POTO2 40
+#define OPT_HKMST1 41
+#define OPT_BUDGET 42
+#define OPT_BFGT 43
+#define OPT_HKMST2 44
+#define OPT_BC 45
+#define OPT_SEED 46
+#define OPT_DENSE 47
+#define OPT_HYBRID 48
+#define OPT_SCC 49
+#define OPT_LEVELS 50
+#define OPT_CRITICAL 51
+#define OPT_PROPAGATE 52
+#define OPT_BUILDTIME 53
+#define OPT_REJECT 54
+#define OPT_QUERY 55
+#define OPT_QUERYSHARED 56
+#define OPT_WITNESS 57
+#define OPT_DELETE 58
+#define OPT_REVERSECHAIN 59
+#define OPT_COMPACT 60
 
 // ----------------
 // Global Variables
@@ -120,20 +214,488 @@ typedef dummy_online_topological_order<subgraph1_t> dummy_graph_t;
 unsigned int ahrsz_ninvalid = 0;
 unsigned int ahrsz_K = 0;
 unsigned int ahrsz_dKfb = 0;
+unsigned int ahrsz_ncompacts = 0;
 unsigned int mnr_ninvalid = 0;
 unsigned int mnr_ARxy = 0;
 unsigned int mnr_ddfxy = 0;
 unsigned int poto1_ninvalid = 0;
 unsigned int poto1_dxy = 0;
 unsigned int poto1_ddxy = 0;
+unsigned int poto1_ARxy = 0;
+unsigned int poto2_ninvalid = 0;
+unsigned int poto2_ddxy = 0;
+unsigned int hkmst1_ninvalid = 0;
+unsigned int hkmst1_ddxy = 0;
+unsigned int hkmst1_ARxy = 0;
+unsigned int bfgt_ninvalid = 0;
+unsigned int bfgt_ddxy = 0;
+unsigned int bfgt_nraised = 0;
+unsigned int hkmst2_ninvalid = 0;
+unsigned int hkmst2_ddxy = 0;
+unsigned int hkmst2_K = 0;
+unsigned int bc_ninvalid = 0;
+unsigned int bc_ddxy = 0;
+unsigned int bc_nchanged = 0;
+unsigned int dense_ninvalid = 0;
+unsigned int dense_nswaps = 0;
+unsigned int dense_nwords = 0;
+unsigned int hybrid_ninvalid = 0;
+unsigned int hybrid_ddxy = 0;
+unsigned int hybrid_nselected[HYBRID_NSTRATEGIES] = {0,0,0};
+unsigned int scc_ninvalid = 0;
+unsigned int scc_ddxy = 0;
+unsigned int scc_ncollapsed = 0;
+unsigned int scc_ncompacts = 0;
 unsigned int algo_count = 0;
 unsigned int ol_ncreated = 0;
 unsigned int ol_nrelabels = 0;
 unsigned int ol2_ncreated = 0;
 unsigned int ol2_nrelabels = 0;
 unsigned int ol2_nrenumbers = 0;
+unsigned int par_nsearches = 0;
+unsigned int budget_nfallbacks = 0;
+unsigned int levels_nraised = 0;
+unsigned int critical_nraised = 0;
+unsigned int prop_nvisited = 0;
+unsigned int prop_nwords = 0;
 
 bool verbose = false;
+bool count_allocs = false;
+unsigned int nthreads = 1;
+unsigned int par_threshold = PAR_DEFAULT_THRESHOLD;
+unsigned int nlanes = 1;
+unsigned int chain = 0;
+bool reverse_chain = false;
+bool concurrent = false;
+unsigned int concurrent_threshold = POTO1_CONCURRENT_THRESHOLD;
+double budget = 0;
+unsigned int seed = BC_DEFAULT_SEED;
+
+// how the levels are kept, if at all
+#define LEVELS_NONE 0
+#define LEVELS_INCREMENTAL 1
+#define LEVELS_FULL 2
+unsigned int levels = LEVELS_NONE;
+
+// likewise for the critical path.  The costs
+// are drawn at random from 1..CRITICAL_MAXCOST.
+#define CRITICAL_MAXCOST 100
+unsigned int critical = LEVELS_NONE;
+// the number of inputs changed before each propagation
+unsigned int propagate = 0;
+// insert with try_add_edge, so edges closing cycles are turned away
+bool reject = false;
+// and also find the cycles closed by those turned away
+bool witness = false;
+// the number of candidate edges asked about after each batch, and
+// whether those each thread is given are answered together.
+unsigned int query = 0;
+bool query_shared = false;
+// the number of edges removed after each batch, per edge inserted
+double deletes = 0;
+// when AHRSZ and SCC compact, or negative to leave them as they are
+double compaction = -1;
+
+// Only MNR, POTO1, POTO2 and DFS can sort the initial graph
+// on several threads, once it has more than threshold nodes.
+
+template<class T, class S>
+void construct(T &graph, S const &g, unsigned int n, unsigned int threshold) {
+  graph = T(g);
+}
+
+template<class S, class N2I, class I2NMAP>
+void construct(mnr_online_topological_order<S,N2I,I2NMAP> &graph, 
+	       S const &g, unsigned int n, unsigned int threshold) {
+  graph = mnr_online_topological_order<S,N2I,I2NMAP>(g,1,n,threshold);
+}
+
+template<class S, class N2I>
+void construct(poto1_online_topological_order<S,N2I> &graph, 
+	       S const &g, unsigned int n, unsigned int threshold) {
+  graph = poto1_online_topological_order<S,N2I>(g,1,n,threshold);
+}
+
+template<class S, class N2I, class I2NMAP>
+void construct(poto2_online_topological_order<S,N2I,I2NMAP> &graph, 
+	       S const &g, unsigned int n, unsigned int threshold) {
+  graph = poto2_online_topological_order<S,N2I,I2NMAP>(g,1,n,threshold);
+}
+
+template<class S, class N2I>
+void construct(simple_topological_order<S,N2I> &graph, 
+	       S const &g, unsigned int n, unsigned int threshold) {
+  graph = simple_topological_order<S,N2I>(g,1,n,threshold);
+}
+
+// Only MNR and POTO1 can make use of extra threads for their
+// searches, and DFS for its sort, so the default is to do nothing.
+
+template<class T>
+void set_parallel(T &graph, unsigned int n, unsigned int threshold) {
+}
+
+template<class T, class N2I, class I2NMAP>
+void set_parallel(mnr_online_topological_order<T,N2I,I2NMAP> &graph, 
+		  unsigned int n, unsigned int threshold) {
+  graph.set_parallel(n,threshold);
+}
+
+template<class T, class N2I>
+void set_parallel(poto1_online_topological_order<T,N2I> &graph, 
+		  unsigned int n, unsigned int threshold) {
+  graph.set_parallel(n,threshold);
+}
+
+template<class T, class N2I>
+void set_parallel(simple_topological_order<T,N2I> &graph, 
+		  unsigned int n, unsigned int threshold) {
+  graph.set_parallel(n,threshold);
+}
+
+// Likewise, only MNR, POTO1 and POTO2 can
+// interleave the searches of a batch.
+
+template<class T>
+void set_lanes(T &graph, unsigned int n) {
+}
+
+template<class T, class N2I, class I2NMAP>
+void set_lanes(mnr_online_topological_order<T,N2I,I2NMAP> &graph, 
+	       unsigned int n) {
+  graph.set_lanes(n);
+}
+
+template<class T, class N2I>
+void set_lanes(poto1_online_topological_order<T,N2I> &graph, 
+	       unsigned int n) {
+  graph.set_lanes(n);
+}
+
+template<class T, class N2I, class I2NMAP>
+void set_lanes(poto2_online_topological_order<T,N2I,I2NMAP> &graph, 
+	       unsigned int n) {
+  graph.set_lanes(n);
+}
+
+// Only POTO1 can run its forward and
+// backward searches concurrently.
+
+template<class T>
+void set_concurrent(T &graph, bool on, unsigned int threshold) {
+}
+
+template<class T, class N2I>
+void set_concurrent(poto1_online_topological_order<T,N2I> &graph, 
+		    bool on, unsigned int threshold) {
+  graph.set_concurrent(on,threshold);
+}
+
+// Only MNR, POTO1 and AHRSZ can fall back
+// to an offline sort.
+
+template<class T>
+void set_budget(T &graph, double factor) {
+}
+
+template<class T, class N2I, class I2NMAP>
+void set_budget(mnr_online_topological_order<T,N2I,I2NMAP> &graph, 
+		double factor) {
+  graph.set_budget(factor);
+}
+
+template<class T, class N2I>
+void set_budget(poto1_online_topological_order<T,N2I> &graph, 
+		double factor) {
+  graph.set_budget(factor);
+}
+
+template<class T, class P, class N2I>
+void set_budget(ahrsz_online_topological_order<T,P,N2I> &graph, 
+		double factor) {
+  graph.set_budget(factor);
+}
+
+// Only AHRSZ and SCC compact.
+
+template<class T>
+void set_compact(T &graph, double factor) {
+}
+
+template<class T, class P, class N2I>
+void set_compact(ahrsz_online_topological_order<T,P,N2I> &graph, 
+		 double factor) {
+  graph.set_compact(factor);
+}
+
+template<class T, class N2I>
+void set_compact(scc_online_topological_order<T,N2I> &graph, 
+		 double factor) {
+  graph.set_compact(factor);
+}
+
+// Only BC is randomised.
+
+template<class T>
+void set_seed(T &graph, unsigned int s) {
+}
+
+template<class T, class N2I>
+void set_seed(bc_online_topological_order<T,N2I> &graph, 
+	      unsigned int s) {
+  graph.reseed(s);
+}
+
+// Only MNR, POTO1 and AHRSZ can say which cycle
+// an edge would have closed.  The others leave
+// cycle empty.
+
+template<class T, class V>
+oto_status witness_add_edge(T &graph, unsigned int t, unsigned int h,
+			    vector<V> &cycle) {
+  cycle.clear();
+  return try_add_edge(t,h,graph);
+}
+
+template<class T, class N2I, class I2NMAP, class V>
+oto_status witness_add_edge(mnr_online_topological_order<T,N2I,I2NMAP> &graph, 
+			    unsigned int t, unsigned int h,
+			    vector<V> &cycle) {
+  return try_add_edge(t,h,graph,cycle);
+}
+
+template<class T, class N2I, class V>
+oto_status witness_add_edge(poto1_online_topological_order<T,N2I> &graph, 
+			    unsigned int t, unsigned int h,
+			    vector<V> &cycle) {
+  return try_add_edge(t,h,graph,cycle);
+}
+
+template<class T, class P, class N2I, class V>
+oto_status witness_add_edge(ahrsz_online_topological_order<T,P,N2I> &graph, 
+			    unsigned int t, unsigned int h,
+			    vector<V> &cycle) {
+  return try_add_edge(t,h,graph,cycle);
+}
+
+// POTO1 also keeps the order itself, which
+// should always agree with n2i.
+
+template<class T>
+bool check_inverse(T &graph) {
+  return true;
+}
+
+template<class T, class N2I>
+bool check_inverse(poto1_online_topological_order<T,N2I> &graph) {
+  typedef typename property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),graph);
+  typename poto1_online_topological_order<T,N2I>::order_iterator i,iend;
+  unsigned int index(0);
+  for(tie(i,iend) = graph.order();i!=iend;++i,++index) {
+    if(n2i[*i] != index) { return false; }
+  }
+  return index == num_vertices(graph);
+}
+
+// The levels kept alongside the order should
+// be the same as those worked out afresh.
+
+template<class S, class T, class L>
+bool check_levels(T &graph, L const &lv) {
+  L fresh((S&) graph);
+  typename T::vertex_iterator i,iend;
+  for(tie(i,iend) = vertices(graph);i!=iend;++i) {
+    if(lv.level(*i) != fresh.level(*i)) {
+      cerr << "Check failure because level[" << *i << "] is " << lv.level(*i);
+      cerr << ", not " << fresh.level(*i) << "." << endl;
+      return false;
+    }
+  }
+  return lv.depth() == fresh.depth();
+}
+
+template<class S, class T, class C>
+bool check_critical(T &graph, C const &cp, vector<unsigned int> const &costs) {
+  C fresh((S&) graph,costs);
+  typename T::vertex_iterator i,iend;
+  for(tie(i,iend) = vertices(graph);i!=iend;++i) {
+    if(cp.head(*i) != fresh.head(*i) || cp.tail(*i) != fresh.tail(*i)) {
+      cerr << "Check failure because path costs for " << *i << " are ";
+      cerr << cp.head(*i) << "/" << cp.tail(*i) << ", not ";
+      cerr << fresh.head(*i) << "/" << fresh.tail(*i) << "." << endl;
+      return false;
+    }
+  }
+  return cp.length() == fresh.length();
+}
+
+// For --propagate, the value of a node is its input plus
+// the largest value of its predecessors.
+
+template<class G>
+class recompute_value {
+private:
+  G const &graph;
+  vector<unsigned int> const &inputs;
+  vector<unsigned int> &values;
+public:
+  recompute_value(G const &g, vector<unsigned int> const &i,
+		  vector<unsigned int> &v) : graph(g), inputs(i), values(v) {}
+
+  bool operator()(typename G::vertex_descriptor v) {
+    unsigned int c(0);
+    typename G::in_edge_iterator i,iend;
+    for(tie(i,iend) = in_edges(v,graph);i!=iend;++i) {
+      c = max(c,values[source(*i,graph)]);
+    }
+    c += inputs[v];
+    if(c == values[v]) { return false; }
+    values[v] = c;
+    return true;
+  }
+};
+
+template<class S, class T>
+bool check_values(T &graph, vector<unsigned int> const &inputs,
+		  vector<unsigned int> const &values) {
+  vector<unsigned int> order;
+  topological_sort((S&) graph,back_inserter(order));
+  vector<unsigned int> fresh(values.size(),0);
+  recompute_value<S> f((S&) graph,inputs,fresh);
+  for(vector<unsigned int>::reverse_iterator i(order.rbegin());i!=order.rend();++i) {
+    f(*i);
+  }
+  for(unsigned int i=0;i!=values.size();++i) {
+    if(values[i] != fresh[i]) {
+      cerr << "Check failure because value[" << i << "] is " << values[i];
+      cerr << ", not " << fresh[i] << "." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// For --query, the candidate edges are split evenly over the
+// reader threads, each of which has its own cycle_query.
+
+template<class G, class N2iMap>
+class query_readers {
+private:
+  oto_thread_pool _pool;
+  vector<cycle_query<G,N2iMap>*> _readers;
+  vector<vector<bool> > _answers;
+  // the current set of queries
+  G const *_g;
+  N2iMap _n2i;
+  vector<pair<unsigned int, unsigned int> > const *_queries;
+public:
+  query_readers(G const &g, N2iMap n2i, unsigned int n)
+    : _pool(n), _answers(_pool.size()), _g(&g), _n2i(n2i) {
+    for(unsigned int i=0;i!=_pool.size();++i) {
+      _readers.push_back(new cycle_query<G,N2iMap>(g));
+    }
+  }
+
+  ~query_readers() {
+    for(unsigned int i=0;i!=_readers.size();++i) {
+      delete _readers[i];
+    }
+  }
+
+  unsigned int nvisited(void) const {
+    unsigned int r(0);
+    for(unsigned int i=0;i!=_readers.size();++i) {
+      r += _readers[i]->nvisited();
+    }
+    return r;
+  }
+
+  // the number of queries answered yes
+  unsigned int ask(vector<pair<unsigned int, unsigned int> > const &queries) {
+    _queries = &queries;
+    _pool.run(worker,this);
+    unsigned int r(0);
+    for(unsigned int i=0;i!=_answers.size();++i) {
+      r += count(_answers[i].begin(),_answers[i].end(),true);
+    }
+    return r;
+  }
+
+  // the answer to query i
+  bool answer(unsigned int i) const {
+    unsigned int n(_queries->size());
+    unsigned int id(0);
+    while(i >= (n * (unsigned long long) (id+1)) / _readers.size()) { ++id; }
+    return _answers[id][i - (n * (unsigned long long) id) / _readers.size()];
+  }
+private:
+  static void worker(void *arg, unsigned int id) {
+    query_readers &q(*((query_readers *) arg));
+    unsigned int n(q._queries->size());
+    unsigned int b((n * (unsigned long long) id) / q._readers.size());
+    unsigned int e((n * (unsigned long long) (id+1)) / q._readers.size());
+    vector<pair<unsigned int, unsigned int> >::const_iterator beg(q._queries->begin());
+    vector<bool> &answers(q._answers[id]);
+    cycle_query<G,N2iMap> &reader(*q._readers[id]);
+    if(query_shared) {
+      reader.would_create_cycles(beg+b,beg+e,*q._g,q._n2i,answers);
+    } else {
+      answers.resize(e-b);
+      for(unsigned int i=b;i!=e;++i) {
+	answers[i-b] = reader.would_create_cycle(beg[i].first,beg[i].second,*q._g,q._n2i);
+      }
+    }
+  }
+};
+
+// Check each answer by searching the whole graph.
+
+template<class S, class R>
+bool check_queries(S const &graph, R const &readers,
+		   vector<pair<unsigned int, unsigned int> > const &queries) {
+  for(unsigned int i=0;i!=queries.size();++i) {
+    unsigned int u(queries[i].first);
+    unsigned int v(queries[i].second);
+    // does v reach u?
+    vector<bool> visited(num_vertices(graph),false);
+    vector<unsigned int> stack(1,v);
+    visited[v] = true;
+    while(!stack.empty() && !visited[u]) {
+      unsigned int x(stack.back());
+      stack.pop_back();
+      typename S::out_edge_iterator j,jend;
+      for(tie(j,jend) = out_edges(x,graph);j!=jend;++j) {
+	if(!visited[target(*j,graph)]) {
+	  visited[target(*j,graph)] = true;
+	  stack.push_back(target(*j,graph));
+	}
+      }
+    }
+    if(visited[u] != readers.answer(i)) {
+      cerr << "Check failure because adding " << u << "->" << v << " was said ";
+      cerr << (visited[u] ? "not " : "") << "to create a cycle." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// The cycle given for t->h must be a path from h to t.
+
+template<class S, class V>
+bool check_witness(S const &graph, unsigned int t, unsigned int h,
+		   vector<V> const &cycle) {
+  bool ok(!cycle.empty() && cycle.front() == h && cycle.back() == t);
+  for(unsigned int i=1;ok && i<cycle.size();++i) {
+    ok = edge(cycle[i-1],cycle[i],graph).second;
+  }
+  if(!ok) {
+    cerr << "Check failure because the cycle given for " << t << "->" << h;
+    cerr << " is not a path from " << h << " to " << t << "." << endl;
+  }
+  return ok;
+}
 
 template<class T>
 void my_print_graph(T &graph) {
@@ -193,40 +755,127 @@ void print_order(T &graph) {
   cout << " }" << endl;
 }
 
-template<class T, class S>
-bool check_solution(T &graph, string const &s) {
+// Any two nodes in order must not have a path the other way.
+
+template<class S, class T>
+bool check_order(T &graph, string const &s) {
   typedef typename property_map<S, n2i_t>::type N2iMap;
+  typedef typename T::vertex_descriptor vd_t;
   N2iMap n2i = get(n2i_t(),graph);
+  // the path queries for each node are answered
+  // together, so they can be interleaved.
+  interleaved_search<T,N2iMap,isearch_path<T> > search(ISEARCH_DEFAULT_LANES,false);
+  vector<pair<vd_t,vd_t> > queries;
+  vector<bool> results;
 
   typename T::vertex_iterator i,iend;
   for(tie(i,iend) = vertices(graph);i!=iend;++i) {
     typename T::vertex_iterator j(i),jend,jdum;
     ++j;
+    queries.clear();
+    for(tie(jdum,jend) = vertices(graph);j!=jend;++j) {
+      if(n2i[*i] < n2i[*j]) {
+	queries.push_back(make_pair(*j,*i));
+      } else if(n2i[*j] < n2i[*i]) {
+	queries.push_back(make_pair(*i,*j));
+      } else {
+	queries.push_back(make_pair(*i,*j));
+	queries.push_back(make_pair(*j,*i));
+      }
+    }
+    paths(queries,results,graph,n2i,search);
+
+    unsigned int q(0);
+    j = i;
+    ++j;
     for(tie(jdum,jend) = vertices(graph);j!=jend;++j) {
       bool f1(n2i[*i] < n2i[*j]);
       bool f2(n2i[*j] < n2i[*i]);
-      if(f1 && path(*j,*i,graph)) {
+      if(f1 && results[q++]) {
 	cerr << "Check failure because n2i[" << *i << "] < n2i[" << *j << "] AND path("; 
 	cerr << *j << "," << *i << "). " << s << endl;
 	my_print_graph(graph);
 	print_order<T,S>(graph);
 	return false;
-      } else if(f2 && path(*i,*j,graph)) {
+      } else if(f2 && results[q++]) {
 	cerr << "Check failure because n2i[" << *j << "] < n2i[" << *i << "] AND path("; 
 	cerr << *i << "," << *j << "). " << s << endl;
 	my_print_graph(graph);
 	print_order<T,S>(graph);
-      } else if(!f1 && !f2 && (path(*i,*j,graph) || path(*j,*i,graph))) {
-	cerr << "Check failure because n2i[" << *j << "] == n2i[" << *i;
-	cerr << "] AND there is at least one path connecting them. " << s << endl;
-	my_print_graph(graph);
-	print_order<T,S>(graph);
+	return false;
+      } else if(!f1 && !f2) {
+	q += 2;
+	if(results[q-2] || results[q-1]) {
+	  cerr << "Check failure because n2i[" << *j << "] == n2i[" << *i;
+	  cerr << "] AND there is at least one path connecting them. " << s << endl;
+	  my_print_graph(graph);
+	  print_order<T,S>(graph);
+	  return false;
+	}
       }
     }
   }
   return true;
 }
 
+// SCC gives every member of a component the same index, so the
+// components are worked out afresh and compared with those kept.
+// Then, every edge between two components must be in order.  Once
+// an edge has gone from inside a component, it may no longer be
+// strongly connected, so nodes sharing an index need not be until
+// the components are next worked out.
+
+template<class S, class S2, class N2I>
+bool check_order(scc_online_topological_order<S2,N2I> &graph, string const &s) {
+  typedef typename property_map<S, n2i_t>::type N2iMap;
+  N2iMap n2i = get(n2i_t(),graph);
+  unsigned int n(num_vertices(graph));
+  vector<unsigned int> comp(n);
+  strong_components((S const &) graph,
+		    make_iterator_property_map(comp.begin(),get(vertex_index,graph)));
+
+  // the first node seen of each component, and with each index
+  vector<int> first(n,-1);
+  map<unsigned int, unsigned int> owner;
+  for(unsigned int v=0;v!=n;++v) {
+    if(first[comp[v]] == -1) {
+      first[comp[v]] = v;
+    } else if(n2i[first[comp[v]]] != n2i[v]) {
+      cerr << "Check failure because " << first[comp[v]] << " and " << v;
+      cerr << " are strongly connected AND n2i[" << first[comp[v]] << "] != n2i[";
+      cerr << v << "]. " << s << endl;
+      return false;
+    }
+    pair<map<unsigned int, unsigned int>::iterator,bool> r(owner.insert(make_pair(n2i[v],v)));
+    if(!r.second && comp[r.first->second] != comp[v] && graph.nstale() == 0) {
+      cerr << "Check failure because n2i[" << r.first->second << "] == n2i[" << v;
+      cerr << "] AND they are not strongly connected. " << s << endl;
+      return false;
+    }
+  }
+
+  typename S::edge_iterator i,iend;
+  for(tie(i,iend) = edges(graph);i!=iend;++i) {
+    unsigned int x(source(*i,graph)), y(target(*i,graph));
+    if(comp[x] != comp[y] && !(n2i[x] < n2i[y]) &&
+       (n2i[x] != n2i[y] || graph.nstale() == 0)) {
+      cerr << "Check failure because " << x << "->" << y << " is between components";
+      cerr << " AND !(n2i[" << x << "] < n2i[" << y << "]). " << s << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+template<class T, class S>
+bool check_solution(T &graph, string const &s) {
+  if(!check_inverse(graph)) {
+    cerr << "Check failure because the order and n2i disagree. " << s << endl;
+    return false;
+  }
+  return check_order<S>(graph,s);
+}
+
 class work_visitor : public default_dfs_visitor {
 protected:
   vector<set<unsigned int> > &_scores;
@@ -255,15 +904,38 @@ public:
   double INVAL;
   double ACPI;
   double COUNT;
+  double PAR;
+  double ALLOCS;
+  double FALLBACK;
+  double LEVELS;
+  double CRITICAL;
+  double PROPAGATE;
+  double BUILD;
+  double REJECTED;
+  double QUERY;
+  double QVISITED;
+  double QCYCLES;
+  double WITNESS;
+  double INSERT;
+  double DELETE;
+  double COMPACT;
+  double SELECTED[HYBRID_NSTRATEGIES];
   unsigned int errors;
 public:
   exp_results() : NCREATED(0), NRELABELS(0),
-		  INVAL(0), ACPI(0), errors(0), COUNT(0) {
+		  INVAL(0), ACPI(0), errors(0), COUNT(0), PAR(0), ALLOCS(0),
+		  FALLBACK(0), LEVELS(0), CRITICAL(0), PROPAGATE(0), BUILD(0),
+		  REJECTED(0), QUERY(0), QVISITED(0), QCYCLES(0),
+		  WITNESS(0), INSERT(0), DELETE(0), COMPACT(0) {
+    fill(SELECTED,SELECTED+HYBRID_NSTRATEGIES,0);
   }
 };
 
+// Returns the time taken to build the
+// order from the initial graph.
+
 template<class T, class S>
-void build_graph(unsigned int V, unsigned int E, unsigned int O, 
+double build_graph(unsigned int V, unsigned int E, unsigned int O, 
 		 vector<pair<unsigned int, unsigned int> > &edges, T &graph,
 		 istream &input) {
   unsigned int v = read_edgelist(input,edges);
@@ -276,6 +948,18 @@ void build_graph(unsigned int V, unsigned int E, unsigned int O,
   }
   // make sure we have the requested number of edges
   edges.resize(E);
+  if(reject) {
+    // the file may have cycles, so the initial graph
+    // is built one edge at a time, dropping any which
+    // close one.
+    my_timer t;
+    while(E-- > O) {
+      pair<unsigned int, unsigned int> &e(edges.back());    
+      try_add_edge(e.first, e.second, graph);
+      edges.pop_back();
+    }
+    return t.elapsed();
+  }
   // create normal graph so we don't end up with a
   // valid topological order after this!
   S tmpg(V);
@@ -286,7 +970,9 @@ void build_graph(unsigned int V, unsigned int E, unsigned int O,
     add_edge(e.first, e.second, tmpg);
     edges.pop_back();
   }
-  graph = T(tmpg);
+  my_timer t;
+  construct(graph,tmpg,nthreads,par_threshold);
+  return t.elapsed();
 }
 		 
 template<class T, class S>
@@ -296,13 +982,33 @@ exp_results do_work(unsigned int V, unsigned int E, unsigned int O, unsigned int
   T graph(V); 
 
   // reset metrics
-  mnr_ninvalid = poto1_ninvalid = ahrsz_ninvalid = 0;
+  mnr_ninvalid = poto1_ninvalid = poto2_ninvalid = ahrsz_ninvalid = 0;
   ol_nrelabels = ol2_nrelabels = ol2_nrenumbers = 0;
-  mnr_ddfxy = poto1_ddxy = ahrsz_dKfb = 0;
+  mnr_ddfxy = poto1_ddxy = poto2_ddxy = ahrsz_dKfb = 0;
   ol_ncreated = ol2_ncreated = 0;
-  mnr_ARxy = 0;algo_count = 0;
+  mnr_ARxy = poto1_ARxy = 0;algo_count = 0;
+  hkmst1_ninvalid = hkmst1_ddxy = hkmst1_ARxy = 0;
+  bfgt_ninvalid = bfgt_ddxy = bfgt_nraised = 0;
+  hkmst2_ninvalid = hkmst2_ddxy = hkmst2_K = 0;
+  bc_ninvalid = bc_ddxy = bc_nchanged = 0;
+  dense_ninvalid = dense_nswaps = dense_nwords = 0;
+  hybrid_ninvalid = hybrid_ddxy = 0;
+  fill(hybrid_nselected,hybrid_nselected+HYBRID_NSTRATEGIES,0);
+  scc_ninvalid = scc_ddxy = scc_ncollapsed = 0;
+  ahrsz_ncompacts = scc_ncompacts = 0;
+  par_nsearches = 0;
+  budget_nfallbacks = 0;
+  levels_nraised = 0;
+  critical_nraised = 0;
+  prop_nvisited = prop_nwords = 0;
 
-  build_graph<T,S>(V,E,O,edges,graph,input);
+  r.BUILD = build_graph<T,S>(V,E,O,edges,graph,input);
+  set_parallel(graph,nthreads,par_threshold);
+  set_lanes(graph,nlanes);
+  set_concurrent(graph,concurrent,concurrent_threshold);
+  set_budget(graph,budget);
+  set_seed(graph,seed);
+  if(compaction >= 0) { set_compact(graph,compaction); }
 
   // because the graph was actually built twice
   ol_ncreated = ol_ncreated >> 1;
@@ -329,32 +1035,260 @@ exp_results do_work(unsigned int V, unsigned int E, unsigned int O, unsigned int
     remove_edge(i->first,i->second,(S&) graph);
   }
   
+  typedef typename property_map<S, n2i_t>::type N2iMap;
+  N2iMap n2i = get(n2i_t(),graph);
+  topological_levels<S,N2iMap> *lv(NULL);
+  if(levels != LEVELS_NONE) {
+    lv = new topological_levels<S,N2iMap>((S&) graph);
+  }
+  critical_path<S,N2iMap> *cp(NULL);
+  vector<unsigned int> costs;
+  if(critical != LEVELS_NONE) {
+    boost::mt19937 rng(seed);
+    for(unsigned int i=0;i!=V;++i) {
+      costs.push_back(1 + rng() % CRITICAL_MAXCOST);
+    }
+    cp = new critical_path<S,N2iMap>((S&) graph,costs);
+  }
+  change_propagation<S,N2iMap> *cg(NULL);
+  vector<unsigned int> inputs,values;
+  boost::mt19937 rng(seed);
+  if(propagate > 0) {
+    // all zero, so the values start off correct
+    cg = new change_propagation<S,N2iMap>((S&) graph);
+    inputs.assign(V,0);
+    values.assign(V,0);
+  }
+  query_readers<S,N2iMap> *qr(NULL);
+  vector<pair<unsigned int, unsigned int> > queries;
+  unsigned int nqueries(0),nqcycles(0);
+  double qtime(0);
+  if(query > 0) {
+    qr = new query_readers<S,N2iMap>((S&) graph,n2i,nthreads);
+  }
+  // the edges which may be removed, drawn at random.  The
+  // set stops an edge inserted twice being listed twice.
+  vector<pair<unsigned int, unsigned int> > present;
+  set<pair<unsigned int, unsigned int> > listed;
+  boost::mt19937 drng(seed);
+  double owed(0),itime(0),dtime(0);
+  unsigned int ndeleted(0);
+  if(deletes > 0) {
+    typename S::edge_iterator i,iend;
+    // qualified, since edges is the list above
+    for(tie(i,iend) = boost::edges((S&) graph);i!=iend;++i) {
+      pair<unsigned int, unsigned int> e(source(*i,(S&) graph),target(*i,(S&) graph));
+      if(listed.insert(e).second) { present.push_back(e); }
+    }
+  }
+
   // begin timing
   my_timer t; 
+  nallocs = 0;
+  alloc_counting = count_allocs;
 
+  unsigned int nrejected(0),nwitness(0);
+  vector<typename S::vertex_descriptor> cycle;
   vector<pair<unsigned int,unsigned int> >::iterator beg(edges.begin());
   vector<pair<unsigned int,unsigned int> >::iterator end;
   for(end=beg+B; beg != edges.end(); end += min<unsigned int>(B,edges.end()-end), beg += min<unsigned int>(B,edges.end()-beg)) {
     // add new edge batch
-    add_edges(beg,end,graph);    
+    my_timer it;
+    if(reject) {
+      for(vector<pair<unsigned int,unsigned int> >::iterator i(beg);i!=end;++i) {
+	if(!witness) {
+	  if(try_add_edge(i->first,i->second,graph) == OTO_CYCLE) { ++nrejected; }
+	} else if(witness_add_edge(graph,i->first,i->second,cycle) == OTO_CYCLE) {
+	  ++nrejected;
+	  nwitness += cycle.size();
+	  if(checking && !check_witness((S&) graph,i->first,i->second,cycle)) {
+	    r.errors++;
+	  }
+	}
+      }
+    } else {
+      add_edges(beg,end,graph);    
+    }
+    itime += it.elapsed();
+
+    // and then take some out again
+    if(deletes > 0) {
+      for(vector<pair<unsigned int,unsigned int> >::iterator i(beg);i!=end;++i) {
+	if(edge(i->first,i->second,(S&) graph).second && listed.insert(*i).second) {
+	  present.push_back(*i);
+	}
+      }
+      owed += deletes * (end - beg);
+      my_timer dt;
+      for(;owed >= 1 && !present.empty();owed -= 1) {
+	unsigned int k(drng() % present.size());
+	swap(present[k],present.back());
+	remove_edge(present.back().first,present.back().second,graph);
+	listed.erase(present.back());
+	present.pop_back();
+	++ndeleted;
+      }
+      dtime += dt.elapsed();
+    }
+
+    if(levels == LEVELS_INCREMENTAL) {
+      for(vector<pair<unsigned int,unsigned int> >::iterator i(beg);i!=end;++i) {
+	lv->edge_added(i->first,i->second,(S&) graph,n2i);
+      }
+    } else if(levels == LEVELS_FULL) {
+      lv->recompute((S&) graph);
+    }
+
+    if(critical == LEVELS_INCREMENTAL) {
+      for(vector<pair<unsigned int,unsigned int> >::iterator i(beg);i!=end;++i) {
+	cp->edge_added(i->first,i->second,(S&) graph,n2i);
+      }
+    } else if(critical == LEVELS_FULL) {
+      cp->recompute((S&) graph);
+    }
+
+    if(cg != NULL) {
+      // the heads of the new edges have new predecessors,
+      // and some inputs are changed as well.
+      for(vector<pair<unsigned int,unsigned int> >::iterator i(beg);i!=end;++i) {
+	cg->mark_dirty(i->second);
+      }
+      for(unsigned int i=0;i!=propagate;++i) {
+	unsigned int v(rng() % V);
+	inputs[v] = 1 + rng() % CRITICAL_MAXCOST;
+	cg->mark_dirty(v);
+      }
+      cg->propagate((S&) graph,n2i,recompute_value<S>((S&) graph,inputs,values));
+    }
 
-    if(checking && !check_solution<T,S>(graph,"BATCH")) {
-      r.errors++;
+    if(qr != NULL) {
+      queries.clear();
+      for(unsigned int i=0;i!=query;++i) {
+	queries.push_back(make_pair(rng() % V,rng() % V));
+      }
+      my_timer qt;
+      nqcycles += qr->ask(queries);
+      qtime += qt.elapsed();
+      nqueries += query;
+    }
+
+    if(checking) {
+      alloc_counting = false;
+      if(!check_solution<T,S>(graph,"BATCH")) {
+	r.errors++;
+      }
+      if(lv != NULL && !check_levels<S>(graph,*lv)) {
+	r.errors++;
+      }
+      if(cp != NULL && !check_critical<S>(graph,*cp,costs)) {
+	r.errors++;
+      }
+      if(cg != NULL && !check_values<S>(graph,inputs,values)) {
+	r.errors++;
+      }
+      if(qr != NULL && !check_queries((S&) graph,*qr,queries)) {
+	r.errors++;
+      }
+      alloc_counting = count_allocs;
     }
   }
+  alloc_counting = false;
+  r.ALLOCS = ((double) nallocs) / edges.size();
 
   // accumulate metrics
-  r.INVAL = ((double) (mnr_ninvalid + poto1_ninvalid + ahrsz_ninvalid)) / edges.size();
-  r.ARXY = ((double) mnr_ARxy) / edges.size();
-  r.DKXY = ((double) (mnr_ddfxy + poto1_ddxy + ahrsz_dKfb)) / edges.size();
+  r.INVAL = ((double) (mnr_ninvalid + poto1_ninvalid + poto2_ninvalid + hkmst1_ninvalid + bfgt_ninvalid + hkmst2_ninvalid + bc_ninvalid + dense_ninvalid + hybrid_ninvalid + scc_ninvalid + ahrsz_ninvalid)) / edges.size();
+  r.ARXY = ((double) (mnr_ARxy + poto1_ARxy + hkmst1_ARxy + bc_nchanged + dense_nswaps)) / edges.size();
+  r.DKXY = ((double) (mnr_ddfxy + poto1_ddxy + poto2_ddxy + hkmst1_ddxy + bfgt_ddxy + hkmst2_ddxy + bc_ddxy + dense_nwords + hybrid_ddxy + scc_ddxy + ahrsz_dKfb)) / edges.size();
   r.NCREATED = ol_ncreated + ol2_ncreated;
   r.NRELABELS = ol_nrelabels + ol2_nrelabels + ol2_nrenumbers;
   r.ACPI = t.elapsed() / edges.size();
   r.COUNT = algo_count / edges.size();  // avg op count per batch
+  if(mnr_ninvalid + poto1_ninvalid > 0) {
+    // fraction of invalidating edges searched in parallel
+    r.PAR = ((double) par_nsearches) / (mnr_ninvalid + poto1_ninvalid);
+  }
+  r.FALLBACK = ((double) budget_nfallbacks) / edges.size();
+  r.LEVELS = ((double) levels_nraised) / edges.size();
+  r.CRITICAL = ((double) critical_nraised) / edges.size();
+  delete lv;
+  r.PROPAGATE = ((double) prop_nvisited) / edges.size();
+  r.REJECTED = ((double) nrejected) / edges.size();
+  if(nrejected > 0) {
+    r.WITNESS = ((double) nwitness) / nrejected;
+  }
+  r.INSERT = itime / edges.size();
+  if(ndeleted > 0) {
+    r.DELETE = dtime / ndeleted;
+  }
+  r.COMPACT = ((double) (ahrsz_ncompacts + scc_ncompacts)) / edges.size();
+  if(nqueries > 0) {
+    r.QUERY = qtime / nqueries;
+    r.QVISITED = ((double) qr->nvisited()) / nqueries;
+    r.QCYCLES = ((double) nqcycles) / nqueries;
+  }
+  delete qr;
+  delete cp;
+  delete cg;
+  if(hybrid_ninvalid > 0) {
+    // fraction of invalidating edges given to each strategy
+    for(unsigned int i=0;i!=HYBRID_NSTRATEGIES;++i) {
+      r.SELECTED[i] = ((double) hybrid_nselected[i]) / hybrid_ninvalid;
+    }
+    // the searches HYBRID borrows also count towards
+    // the totals of MNR, POTO1 and HKMST1.
+    r.DKXY = ((double) hybrid_ddxy) / edges.size();
+  }
 
   return r;
 }
 
+// Build the path 0->1->...->n-2 and then insert the edge (n-1,0).
+// Since node n-1 starts off at the end of the order, the whole path
+// must be searched (and moved) in one go.  This is useful for
+// checking that no traversal can overflow the stack.  When reversed,
+// the path is 1->2->...->n-1 instead, so that the forward search from
+// 0 finds nothing and the backward search from n-1 covers the path.
+
+template<class T, class S>
+exp_results do_chain(unsigned int n, bool reversed, bool checking) {
+  typedef typename property_map<S, n2i_t>::type N2iMap;
+  exp_results r;
+  T graph(n); 
+
+  set_parallel(graph,nthreads,par_threshold);
+  set_lanes(graph,nlanes);
+  set_concurrent(graph,concurrent,concurrent_threshold);
+  set_budget(graph,budget);
+  set_seed(graph,seed);
+  if(compaction >= 0) { set_compact(graph,compaction); }
+
+  vector<pair<unsigned int,unsigned int> > es;
+  unsigned int first(reversed ? 1 : 0);
+  for(unsigned int i=first;i+2<n+first;++i) {
+    es.push_back(make_pair(i,i+1));
+  }
+  add_edges(es.begin(),es.end(),graph);
+
+  es.clear();
+  es.push_back(make_pair(n-1,0));
+  my_timer t; 
+  add_edges(es.begin(),es.end(),graph);
+  r.ACPI = t.elapsed();
+
+  if(checking) {
+    // check_solution is far too slow here,
+    // but checking each edge is enough.
+    N2iMap n2i = get(n2i_t(),graph);
+    typename T::edge_iterator i,iend;
+    for(tie(i,iend) = edges(graph);i!=iend;++i) {
+      if(!(n2i[source(*i,graph)] < n2i[target(*i,graph)])) {
+	r.errors++;
+      }
+    }
+  }
+  return r;
+}
+
 bool find_replace(string &str, string const &match, string const &replace) {
   unsigned int pos(0);
   string r;
@@ -398,6 +1332,14 @@ int main(int argc, char *argv[]) {
     {"MNR",no_argument,NULL,OPT_MNR},
     {"AHRSZ",no_argument,NULL,OPT_AHRSZ},
     {"POTO1",no_argument,NULL,OPT_POTO1},
+    {"POTO2",no_argument,NULL,OPT_POTO2},
+    {"HKMST1",no_argument,NULL,OPT_HKMST1},
+    {"BFGT",no_argument,NULL,OPT_BFGT},
+    {"HKMST2",no_argument,NULL,OPT_HKMST2},
+    {"BC",no_argument,NULL,OPT_BC},
+    {"DENSE",no_argument,NULL,OPT_DENSE},
+    {"HYBRID",no_argument,NULL,OPT_HYBRID},
+    {"SCC",no_argument,NULL,OPT_SCC},
     {"AHRSZb",no_argument,NULL,OPT_AHRSZB},
     {"DFS",no_argument,NULL,OPT_DFS},
     {"sample",required_argument,NULL,OPT_SAMPLE},
@@ -407,6 +1349,25 @@ int main(int argc, char *argv[]) {
     {"verbose",no_argument,NULL,OPT_VERBOSE},
     {"sample-fixed",required_argument,NULL,OPT_SAMPLEFIXED},
     {"num-graphs",required_argument,NULL,OPT_NGRAPHS},
+    {"threads",required_argument,NULL,OPT_THREADS},
+    {"par-threshold",required_argument,NULL,OPT_PARTHRESHOLD},
+    {"count-allocs",no_argument,NULL,OPT_COUNTALLOCS},
+    {"lanes",required_argument,NULL,OPT_LANES},
+    {"chain",required_argument,NULL,OPT_CHAIN},
+    {"reverse-chain",no_argument,NULL,OPT_REVERSECHAIN},
+    {"concurrent",required_argument,NULL,OPT_CONCURRENT},
+    {"budget",required_argument,NULL,OPT_BUDGET},
+    {"seed",required_argument,NULL,OPT_SEED},
+    {"levels",required_argument,NULL,OPT_LEVELS},
+    {"critical",required_argument,NULL,OPT_CRITICAL},
+    {"propagate",required_argument,NULL,OPT_PROPAGATE},
+    {"build-time",no_argument,NULL,OPT_BUILDTIME},
+    {"reject",no_argument,NULL,OPT_REJECT},
+    {"query",required_argument,NULL,OPT_QUERY},
+    {"query-shared",no_argument,NULL,OPT_QUERYSHARED},
+    {"witness",no_argument,NULL,OPT_WITNESS},
+    {"delete",required_argument,NULL,OPT_DELETE},
+    {"compact",required_argument,NULL,OPT_COMPACT},
     NULL
   };
 
@@ -429,8 +1390,88 @@ int main(int argc, char *argv[]) {
     " -n<x>  --num-graphs=<x>          Iterate over x graphs.",
     " -d<x>  --density=<x>             set the ratio of expected actual edges versus the maximum",
     "                                  number of possible edges.",
+    " -t<x>  --threads=<x>             use x threads for large forward searches (MNR and",
+    "                                  POTO1 only).  ARxy is reported so the speedup can",
+    "                                  be plotted against the size of the affected region.",
+    "                                  MNR, POTO1, POTO2 and DFS also sort the initial graph",
+    "                                  using x threads, and DFS uses them for every sort.",
+    "        --par-threshold=<x>       only go parallel once the search frontier (or, for",
+    "                                  DFS and the initial sort, the graph) exceeds x nodes",
+    "                                  (default=4096).",
+    "        --build-time              report the time taken to build the order from the",
+    "                                  initial graph (BUILD).",
+    "        --reject                  insert each edge with try_add_edge, which turns away",
+    "                                  (rather than throws on) any edge closing a cycle, so",
+    "                                  the graphs in the file need not be acyclic.  REJECTED",
+    "                                  is the fraction of sampled edges turned away.  This",
+    "                                  can't be used with --levels, --critical or --propagate.",
+    "        --witness                 as --reject, but also find the cycle each edge turned",
+    "                                  away would close (MNR, POTO1 and AHRSZ only).  WITNESS",
+    "                                  is the average number of nodes on them.",
+    "        --query=<x>               after each batch, ask whether x random edges would",
+    "                                  create a cycle, without adding them.  The queries are",
+    "                                  split over the --threads.  QUERY is the time taken per",
+    "                                  query, QVISITED the nodes visited per query and QCYCLES",
+    "                                  the fraction answered yes.",
+    "        --query-shared            answer each thread's queries together, sweeping",
+    "                                  once upwards from up to 64 heads at a time, so that",
+    "                                  a node reached from several is only visited once.",
+    "        --delete=<x>              after each batch, remove x edges (chosen at random)",
+    "                                  for each edge inserted.  INSERT and DELETE are the",
+    "                                  times taken per edge inserted and removed.  This",
+    "                                  can't be used with --levels, --critical or --propagate.",
+    "        --compact=<x>             renumber the priorities of AHRSZ once there are more",
+    "                                  than x per node (default=0, never), and work out the",
+    "                                  components of SCC afresh once x edges per node have",
+    "                                  gone from inside them (default=1).  Zero turns this",
+    "                                  off.  COMPACT is the number of times per edge inserted.",
+    "        --count-allocs            report heap allocations per edge inserted (ALLOCS).",
+    "                                  Compare against --DUMMY, which gives the allocations",
+    "                                  made by the underlying graph type itself.",
+    "        --lanes=<x>               interleave up to x searches when inserting a batch",
+    "                                  (MNR, POTO1 and POTO2 only, use with -b).",
+    "        --chain=<x>               instead of the usual experiment, build a path of x",
+    "                                  nodes and time one edge which reverses it all.",
+    "        --reverse-chain           with --chain, put the path behind the new edge's",
+    "                                  tail, so the backward search does the work.",
+    "        --concurrent=<x>          run the forward and backward searches on two threads",
+    "                                  when more than x nodes are affected (POTO1 only).",
+    "        --budget=<x>              give up on any insertion costing more than x times",
+    "                                  an offline sort, and sort offline instead.  FALLBACK",
+    "                                  is the fraction of edges for which this happened",
+    "                                  (MNR, POTO1 and AHRSZ only).",
+    "        --seed=<x>                seed the random choices made by the algorithm",
+    "                                  (BC only, default=5489).",
+    "        --levels=<x>              also keep the level (longest path from a source) of",
+    "                                  each node, either incrementally (x=inc) or by doing",
+    "                                  it afresh after each batch (x=full).  LEVELS is the",
+    "                                  number of levels raised per edge.",
+    "        --critical=<x>            also keep the critical path, with random node costs",
+    "                                  (drawn using --seed), either incrementally (x=inc)",
+    "                                  or afresh after each batch (x=full).  CRITICAL is",
+    "                                  the number of path costs raised per edge.",
+    "        --propagate=<x>           after each batch, change the inputs of x random nodes",
+    "                                  and propagate the changes (and those made by the new",
+    "                                  edges) in topological order.  PROPAGATE is the number",
+    "                                  of nodes visited per edge.",
     "        --MNR                     use online topological sorting algorithm by",
     "        --POTO1                   use algorithm POTO1 from PhD thesis of David J. Pearce",
+    "        --POTO2                   use the batch version of POTO1 (use with -b)",
+    "        --HKMST1                  use the two-way ordered search of Haeupler et al.",
+    "        --BFGT                    use the level based algorithm of Bender et al.",
+    "        --HKMST2                  use the soft-threshold search of Haeupler et al.  Like",
+    "                                  AHRSZ, this uses the O(1) amortized priority space",
+    "        --BC                      use the randomised algorithm of Bernstein and Chechik.",
+    "                                  ARxy is the number of nodes whose sampled ancestors",
+    "                                  or descendants changed.",
+    "        --DENSE                   use the algorithm of Ajwani et al. over bit matrices,",
+    "                                  for dense graphs.  ARxy is the number of swaps, and",
+    "                                  instead of edges, |>dxy<| counts the words read.",
+    "        --HYBRID                  choose between MNR, POTO1 and HKMST1 for each edge.",
+    "                                  The fraction of invalidating edges given to each is",
+    "                                  reported.",
+    "        --SCC                     use POTO1, but collapse any cycles instead of rejecting",
+    "                                  the edges that close them.",
     "        --AHRSZ                   Use algorithm by Alpern et al.  This implementation uses",
     "                                  an O(1) amortized time priority space data structure",
     "        --AHRSZb                  Use algorithm by Alpern et al.  This implementation uses",
@@ -458,6 +1499,19 @@ int main(int argc, char *argv[]) {
   bool rep_NCREATED = false;
   bool rep_NRELABELS = false;
   bool rep_COUNT = false;
+  bool rep_PAR = false;
+  bool rep_ALLOCS = false;
+  bool rep_FALLBACK = false;
+  bool rep_SELECTED = false;
+  bool rep_LEVELS = false;
+  bool rep_CRITICAL = false;
+  bool rep_PROPAGATE = false;
+  bool rep_BUILD = false;
+  bool rep_REJECTED = false;
+  bool rep_QUERY = false;
+  bool rep_WITNESS = false;
+  bool rep_DELETE = false;
+  bool rep_COMPACT = false;
   bool checking = false;
   range<unsigned int> Vr;
   range<double> Er;
@@ -468,7 +1522,7 @@ int main(int argc, char *argv[]) {
 
     // parse command line arguments
     char v;
-    while((v=getopt_long(argc,argv,"b:hv:d:o:n:i:s:f:e:",long_options,NULL)) != -1) {
+    while((v=getopt_long(argc,argv,"b:hv:d:o:n:i:s:f:e:t:",long_options,NULL)) != -1) {
       switch(v)
 	{      
 	case 'h':
@@ -528,6 +1582,91 @@ int main(int argc, char *argv[]) {
 	case OPT_INPUT:
 	  infile = string(optarg);
 	  break;	
+	case 't':
+	case OPT_THREADS:
+	  nthreads = atoi(optarg);
+	  break;
+	case OPT_PARTHRESHOLD:
+	  par_threshold = atoi(optarg);
+	  break;
+	case OPT_COUNTALLOCS:
+	  count_allocs = true;
+	  rep_ALLOCS = true;
+	  break;
+	case OPT_LANES:
+	  nlanes = atoi(optarg);
+	  break;
+	case OPT_CHAIN:
+	  chain = atoi(optarg);
+	  break;
+	case OPT_REVERSECHAIN:
+	  reverse_chain = true;
+	  break;
+	case OPT_CONCURRENT:
+	  concurrent = true;
+	  concurrent_threshold = atoi(optarg);
+	  break;
+	case OPT_BUDGET:
+	  budget = atof(optarg);
+	  rep_FALLBACK = budget > 0;
+	  break;
+	case OPT_SEED:
+	  seed = strtoul(optarg,NULL,10);
+	  break;
+	case OPT_LEVELS:
+	  if(strcmp(optarg,"inc") == 0) {
+	    levels = LEVELS_INCREMENTAL;
+	  } else if(strcmp(optarg,"full") == 0) {
+	    levels = LEVELS_FULL;
+	  } else {
+	    cerr << "levels must be either inc or full" << endl;
+	    exit(1);
+	  }
+	  rep_LEVELS = true;
+	  break;
+	case OPT_CRITICAL:
+	  if(strcmp(optarg,"inc") == 0) {
+	    critical = LEVELS_INCREMENTAL;
+	  } else if(strcmp(optarg,"full") == 0) {
+	    critical = LEVELS_FULL;
+	  } else {
+	    cerr << "critical must be either inc or full" << endl;
+	    exit(1);
+	  }
+	  rep_CRITICAL = critical == LEVELS_INCREMENTAL;
+	  break;
+	case OPT_BUILDTIME:
+	  rep_BUILD = true;
+	  break;
+	case OPT_REJECT:
+	  reject = true;
+	  rep_REJECTED = true;
+	  break;
+	case OPT_WITNESS:
+	  reject = true;
+	  witness = true;
+	  rep_REJECTED = true;
+	  rep_WITNESS = true;
+	  break;
+	case OPT_QUERY:
+	  query = atoi(optarg);
+	  rep_QUERY = query > 0;
+	  break;
+	case OPT_QUERYSHARED:
+	  query_shared = true;
+	  break;
+	case OPT_DELETE:
+	  deletes = atof(optarg);
+	  rep_DELETE = deletes > 0;
+	  break;
+	case OPT_COMPACT:
+	  compaction = atof(optarg);
+	  rep_COMPACT = true;
+	  break;
+	case OPT_PROPAGATE:
+	  propagate = atoi(optarg);
+	  rep_PROPAGATE = true;
+	  break;
 	  
 	  /* === ALGORITHMS === */
 	  
@@ -546,6 +1685,52 @@ int main(int argc, char *argv[]) {
 	  rep_DKXY = true;
 	  rep_INVAL = true;
 	  break;
+	case OPT_POTO2:
+	  algorithm=OPT_POTO2;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  rep_COUNT = true;
+	  break;
+	case OPT_HKMST1:
+	  algorithm=OPT_HKMST1;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  break;
+	case OPT_BFGT:
+	  algorithm=OPT_BFGT;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  break;
+	case OPT_HKMST2:
+	  algorithm=OPT_HKMST2;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  rep_NCREATED = true;
+	  rep_NRELABELS = true;
+	  break;
+	case OPT_BC:
+	  algorithm=OPT_BC;
+	  rep_ARXY = true;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  break;
+	case OPT_DENSE:
+	  algorithm=OPT_DENSE;
+	  rep_ARXY = true;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  break;
+	case OPT_HYBRID:
+	  algorithm=OPT_HYBRID;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  rep_SELECTED = true;
+	  break;
+	case OPT_SCC:
+	  algorithm=OPT_SCC;
+	  rep_DKXY = true;
+	  rep_INVAL = true;
+	  break;
 	case OPT_AHRSZ:
 	  algorithm=OPT_AHRSZ;
 	  rep_DKXY = true;
@@ -571,6 +1756,22 @@ int main(int argc, char *argv[]) {
 	}
     }
 
+    if(reject && (levels != LEVELS_NONE || critical != LEVELS_NONE || propagate > 0)) {
+      cerr << "--reject can't be used with --levels, --critical or --propagate" << endl;
+      exit(1);
+    }
+
+    if(deletes > 0 && (levels != LEVELS_NONE || critical != LEVELS_NONE || propagate > 0)) {
+      cerr << "--delete can't be used with --levels, --critical or --propagate" << endl;
+      exit(1);
+    }
+
+    if(witness && algorithm != OPT_MNR && algorithm != OPT_POTO1 &&
+       algorithm != OPT_AHRSZ && algorithm != OPT_AHRSZB) {
+      cerr << "--witness can only be used with MNR, POTO1 and AHRSZ" << endl;
+      exit(1);
+    }
+
     // Print out file headers
     time_t tm = time(NULL);    
     char hostname[128]="unknown";
@@ -584,6 +1785,44 @@ int main(int argc, char *argv[]) {
       cout << "# SAMPLE SIZE: " << over << endl;
     }
     cout << "# NGRAPHS: " << ngraphs << endl;
+    cout << "# THREADS: " << nthreads << endl;
+    cout << "# LANES: " << nlanes << endl;
+    if(concurrent) {
+      cout << "# CONCURRENT: " << concurrent_threshold << endl;
+    }
+    if(budget > 0) {
+      cout << "# BUDGET: " << budget << endl;
+    }
+    if(algorithm == OPT_BC || critical != LEVELS_NONE || rep_PROPAGATE || rep_QUERY ||
+       rep_DELETE) {
+      cout << "# SEED: " << seed << endl;
+    }
+    if(levels == LEVELS_INCREMENTAL) {
+      cout << "# LEVELS: incremental" << endl;
+    } else if(levels == LEVELS_FULL) {
+      cout << "# LEVELS: full" << endl;
+    }
+    if(critical == LEVELS_INCREMENTAL) {
+      cout << "# CRITICAL: incremental" << endl;
+    } else if(critical == LEVELS_FULL) {
+      cout << "# CRITICAL: full" << endl;
+    }
+    if(rep_PROPAGATE) {
+      cout << "# PROPAGATE: " << propagate << endl;
+    }
+    if(rep_QUERY) {
+      cout << "# QUERY: " << query << (query_shared ? " (shared)" : "") << endl;
+    }
+    if(rep_DELETE) {
+      cout << "# DELETE: " << deletes << endl;
+    }
+    if(rep_COMPACT) {
+      cout << "# COMPACT: " << compaction << endl;
+    }
+    if(nthreads > 1 && (algorithm == OPT_MNR || algorithm == OPT_POTO1)) {
+      rep_ARXY = true;
+      rep_PAR = true;
+    }
     switch(algorithm) {
     case OPT_MNR:
       cout << "# ALGORITHM: MNR " << endl;
@@ -591,6 +1830,30 @@ int main(int argc, char *argv[]) {
     case OPT_POTO1:
       cout << "# ALGORITHM: POTO1 " << endl;
       break;
+    case OPT_POTO2:
+      cout << "# ALGORITHM: POTO2 " << endl;
+      break;
+    case OPT_HKMST1:
+      cout << "# ALGORITHM: HKMST1 " << endl;
+      break;
+    case OPT_BFGT:
+      cout << "# ALGORITHM: BFGT " << endl;
+      break;
+    case OPT_HKMST2:
+      cout << "# ALGORITHM: HKMST2 " << endl;
+      break;
+    case OPT_BC:
+      cout << "# ALGORITHM: BC " << endl;
+      break;
+    case OPT_DENSE:
+      cout << "# ALGORITHM: DENSE " << endl;
+      break;
+    case OPT_HYBRID:
+      cout << "# ALGORITHM: HYBRID " << endl;
+      break;
+    case OPT_SCC:
+      cout << "# ALGORITHM: SCC " << endl;
+      break;
     case OPT_AHRSZB:
       cout << "# ALGORITHM: AHRSZb " << endl;
       break;
@@ -607,6 +1870,61 @@ int main(int argc, char *argv[]) {
     
     cout << "#" << endl;
 
+    if(chain > 0) {
+      exp_results r;
+      cout << "# V\tACPI   \t";
+      if(checking) { cout << "ERRORS"; }
+      cout << endl;
+      switch(algorithm) {	
+      case OPT_POTO1:
+	r = do_chain<POTO1_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_POTO2:
+	r = do_chain<POTO2_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_HKMST1:
+	r = do_chain<HKMST1_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_BFGT:
+	r = do_chain<BFGT_graph_t,subgraph4_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_HKMST2:
+	r = do_chain<HKMST2_graph_t,subgraph3_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_BC:
+	r = do_chain<BC_graph_t,subgraph5_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_DENSE:
+	r = do_chain<DENSE_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_HYBRID:
+	r = do_chain<HYBRID_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_SCC:
+	r = do_chain<SCC_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_MNR:
+	r = do_chain<MNR_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_AHRSZ:
+	r = do_chain<AHRSZ_graph_t,subgraph3_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_AHRSZB:
+	r = do_chain<AHRSZb_graph_t,subgraph2_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_DFS:
+	r = do_chain<DFS_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      case OPT_DUMMY:
+	r = do_chain<dummy_graph_t,subgraph1_t>(chain,reverse_chain,checking);
+	break;
+      }
+      cout << chain << "\t" << r.ACPI << "\t";
+      if(checking) { cout << r.errors << "\t"; }
+      cout << endl;
+      exit(0);
+    }
+
     switch(conversion) {
     case OPT_EDGES:
       cout << "# V\tE\tB\t";
@@ -627,6 +1945,14 @@ int main(int argc, char *argv[]) {
 	cout << "|>dxy|  \t"; 
 	break;
       case OPT_POTO1:
+      case OPT_POTO2:
+      case OPT_HKMST1:
+      case OPT_BFGT:
+      case OPT_HKMST2:
+      case OPT_BC:
+      case OPT_DENSE:
+      case OPT_HYBRID:
+      case OPT_SCC:
 	cout << "|>dxy<| \t"; 
 	break;
       case OPT_AHRSZB:
@@ -639,6 +1965,19 @@ int main(int argc, char *argv[]) {
     if(rep_NCREATED) { cout << "NCREATED\t"; }
     if(rep_NRELABELS) { cout << "NRELABELS\t"; }
     if(rep_COUNT) { cout << "COUNT\t"; }
+    if(rep_PAR) { cout << "PAR\t"; }
+    if(rep_ALLOCS) { cout << "ALLOCS\t"; }
+    if(rep_FALLBACK) { cout << "FALLBACK\t"; }
+    if(rep_SELECTED) { cout << "MNR\tPOTO1\tHKMST1\t"; }
+    if(rep_LEVELS) { cout << "LEVELS\t"; }
+    if(rep_CRITICAL) { cout << "CRITICAL\t"; }
+    if(rep_PROPAGATE) { cout << "PROPAGATE\t"; }
+    if(rep_BUILD) { cout << "BUILD\t"; }
+    if(rep_REJECTED) { cout << "REJECTED\t"; }
+    if(rep_WITNESS) { cout << "WITNESS\t"; }
+    if(rep_QUERY) { cout << "QUERY  \tQVISITED\tQCYCLES\t"; }
+    if(rep_DELETE) { cout << "INSERT  \tDELETE  \t"; }
+    if(rep_COMPACT) { cout << "COMPACT\t"; }
     if(checking) { cout << "ERRORS"; }
     cout << endl;
 
@@ -680,7 +2019,11 @@ int main(int argc, char *argv[]) {
 	    cerr << O << ", B = " << B << " , NGRAPHS = " << ngraphs << endl;	    
 	  }   
 	  
-	  average ARXY,DKXY,ACPI,INVAL,NCREATED,NRELABELS,COUNT;
+	  average ARXY,DKXY,ACPI,INVAL,NCREATED,NRELABELS,COUNT,PAR,ALLOCS,FALLBACK;
+	  average SELECTED[HYBRID_NSTRATEGIES];
+	  average LEVELS,CRITICAL,PROPAGATE,BUILD,REJECTED;
+	  average QUERY,QVISITED,QCYCLES,WITNESS;
+	  average INSERT,DELETE,COMPACT;
 	  unsigned int errors(0);
 
 	  for(int i=0;i!=ngraphs;++i) {
@@ -690,6 +2033,30 @@ int main(int argc, char *argv[]) {
 	    case OPT_POTO1:
 	      r = do_work<POTO1_graph_t,subgraph1_t>(V,E,O,B,checking,input);
 	      break;
+	    case OPT_POTO2:
+	      r = do_work<POTO2_graph_t,subgraph1_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_HKMST1:
+	      r = do_work<HKMST1_graph_t,subgraph1_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_BFGT:
+	      r = do_work<BFGT_graph_t,subgraph4_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_HKMST2:
+	      r = do_work<HKMST2_graph_t,subgraph3_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_BC:
+	      r = do_work<BC_graph_t,subgraph5_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_DENSE:
+	      r = do_work<DENSE_graph_t,subgraph1_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_HYBRID:
+	      r = do_work<HYBRID_graph_t,subgraph1_t>(V,E,O,B,checking,input);
+	      break;
+	    case OPT_SCC:
+	      r = do_work<SCC_graph_t,subgraph1_t>(V,E,O,B,checking,input);
+	      break;
 	    case OPT_MNR:
 	      r = do_work<MNR_graph_t,subgraph1_t>(V,E,O,B,checking,input);
 	      break;
@@ -717,6 +2084,24 @@ int main(int argc, char *argv[]) {
 	    INVAL += r.INVAL;
 	    errors += r.errors;
 	    COUNT += r.COUNT;
+	    PAR += r.PAR;
+	    ALLOCS += r.ALLOCS;
+	    FALLBACK += r.FALLBACK;
+	    for(unsigned int i=0;i!=HYBRID_NSTRATEGIES;++i) {
+	      SELECTED[i] += r.SELECTED[i];
+	    }
+	    LEVELS += r.LEVELS;
+	    CRITICAL += r.CRITICAL;
+	    PROPAGATE += r.PROPAGATE;
+	    BUILD += r.BUILD;
+	    REJECTED += r.REJECTED;
+	    WITNESS += r.WITNESS;
+	    QUERY += r.QUERY;
+	    QVISITED += r.QVISITED;
+	    QCYCLES += r.QCYCLES;
+	    INSERT += r.INSERT;
+	    DELETE += r.DELETE;
+	    COMPACT += r.COMPACT;
 	  }
 	  
 	  // report final results
@@ -730,6 +2115,28 @@ int main(int argc, char *argv[]) {
 	  if(rep_NCREATED) { cout << NCREATED.value()<< "\t"; }
 	  if(rep_NRELABELS) { cout << NRELABELS.value()<< "\t"; }
 	  if(rep_COUNT) { cout << COUNT.value() << "\t"; }
+	  if(rep_PAR) { cout << PAR.value() << "\t"; }
+	  if(rep_ALLOCS) { cout << ALLOCS.value() << "\t"; }
+	  if(rep_FALLBACK) { cout << FALLBACK.value() << "\t"; }
+	  if(rep_SELECTED) { 
+	    for(unsigned int i=0;i!=HYBRID_NSTRATEGIES;++i) {
+	      cout << SELECTED[i].value() << "\t"; 
+	    }
+	  }
+	  if(rep_LEVELS) { cout << LEVELS.value() << "\t"; }
+	  if(rep_CRITICAL) { cout << CRITICAL.value() << "\t"; }
+	  if(rep_PROPAGATE) { cout << PROPAGATE.value() << "\t"; }
+	  if(rep_BUILD) { cout << BUILD.value() << "\t"; }
+	  if(rep_REJECTED) { cout << REJECTED.value() << "\t"; }
+	  if(rep_WITNESS) { cout << WITNESS.value() << "\t"; }
+	  if(rep_QUERY) {
+	    cout << QUERY.value() << "\t" << QVISITED.value() << "\t";
+	    cout << QCYCLES.value() << "\t";
+	  }
+	  if(rep_DELETE) {
+	    cout << INSERT.value() << "\t" << DELETE.value() << "\t";
+	  }
+	  if(rep_COMPACT) { cout << COMPACT.value() << "\t"; }
 	  if(checking) { cout << errors << "\t"; }
 	  cout << endl;
 	} while(!Er.step());
@@ -740,7 +2147,7 @@ int main(int argc, char *argv[]) {
   } catch(runtime_error &e) {
     cerr << "Internal failure - " << e.what() << endl;
     exit(1);
-  } catch(exception &e) {
+  } catch(std::exception &e) {
     cerr << "Internal failure - " << e.what() << endl;
     exit(1);
   } catch (...) {
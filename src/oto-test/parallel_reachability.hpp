@@ -0,0 +1,287 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// A parallel version of the bounded forward search used by MNR
+// and POTO1.  That is, starting from the head h of the inserted
+// edge, find every node w reachable from h with n2i[w] < ub and
+// report a cycle if a node with n2i[w] == ub is encountered.
+//
+// The search begins sequentially on the calling thread.  Only if
+// the worklist grows beyond the threshold are the helper threads
+// woken up, so that small searches never pay for synchronisation.
+// Each thread has its own worklist, protected by a lock, and idle
+// threads steal half of another thread's worklist.  Nodes are
+// claimed with an atomic compare-and-swap so each node is expanded
+// exactly once.  The search terminates when the count of pending
+// nodes drops to zero, or as soon as a cycle is seen.
+//
+// Every flag and counter shared between the threads (the claim
+// marks, the cycle flag, the pending count and the worklist size
+// hints) is read and written with the __atomic builtins; only the
+// worklists themselves are guarded by their locks.
+
+#ifndef PARALLEL_REACHABILITY_HPP
+#define PARALLEL_REACHABILITY_HPP
+
+#include <vector>
+#include <sched.h>
+#include <pthread.h>
+#include "thread_pool.hpp"
+
+#ifdef PAR_GENERATE_STATS
+extern unsigned int par_nsearches;
+#endif
+
+// the frontier size at which the helper
+// threads are brought in.
+#define PAR_DEFAULT_THRESHOLD 4096
+
+template<class G, class N2iMap>
+class par_bounded_search {
+public:
+  typedef typename G::vertex_descriptor vd_t;
+private:
+  typedef typename G::out_edge_iterator out_iterator;
+
+  struct local_t {
+    pthread_mutex_t lock;
+    std::vector<vd_t> stack;
+    std::vector<vd_t> found;
+    std::vector<vd_t> buffer; // successors of the node being expanded
+    unsigned int nvisits;
+    unsigned int nstack; // size of stack, readable without the lock
+    char pad[64]; // keep locals on separate cache lines
+
+    local_t() : nvisits(0), nstack(0) { pthread_mutex_init(&lock,NULL); }
+    ~local_t() { pthread_mutex_destroy(&lock); }
+  };
+
+  unsigned int _nthreads;
+  unsigned int _threshold;
+  oto_thread_pool *_pool;
+  std::vector<local_t*> _locals;
+  std::vector<unsigned char> _claimed;
+
+  // state of the current search
+  G const *_g;
+  N2iMap *_n2i;
+  unsigned int _ub;
+  int _cycle;
+  long _pending;
+public:
+  par_bounded_search(unsigned int nthreads = 1,
+		     unsigned int threshold = PAR_DEFAULT_THRESHOLD)
+    : _nthreads(nthreads), _threshold(threshold), _pool(NULL) {
+  }
+
+  // copying only copies the settings; the threads
+  // and scratch space are created again on demand.
+  par_bounded_search(par_bounded_search const &src)
+    : _nthreads(src._nthreads), _threshold(src._threshold), _pool(NULL) {
+  }
+
+  ~par_bounded_search() {
+    release();
+  }
+
+  void operator=(par_bounded_search const &src) {
+    if(&src != this) {
+      configure(src._nthreads,src._threshold);
+    }
+  }
+
+  void configure(unsigned int nthreads, unsigned int threshold) {
+    if(nthreads != _nthreads) { release(); }
+    _nthreads = nthreads;
+    _threshold = threshold;
+  }
+
+  // is a search over a window of this size
+  // worth doing in parallel?
+  bool active(unsigned int window) const {
+    return _nthreads > 1 && window > _threshold;
+  }
+
+  template<class Container>
+  bool search(vd_t h, unsigned int ub, G const &g, N2iMap &n2i,
+	      Container &reachable, unsigned int &nvisits) {
+    if(_locals.empty()) {
+      for(unsigned int i=0;i!=_nthreads;++i) {
+	_locals.push_back(new local_t());
+      }
+    }
+    if(_claimed.size() < num_vertices(g)) {
+      _claimed.resize(num_vertices(g),0);
+    }
+
+    _g = &g;
+    _n2i = &n2i;
+    _ub = ub;
+    __atomic_store_n(&_cycle,0,__ATOMIC_RELAXED);
+
+    // sequential phase
+    local_t &l0(*_locals[0]);
+    _claimed[h] = 1;
+    l0.found.push_back(h);
+    l0.stack.push_back(h);
+    while(!cycle() && !l0.stack.empty() && l0.stack.size() <= _threshold) {
+      vd_t n(l0.stack.back());
+      l0.stack.pop_back();
+      expand(n,l0);
+      l0.stack.insert(l0.stack.end(),l0.buffer.begin(),l0.buffer.end());
+    }
+
+    // parallel phase
+    if(!cycle() && !l0.stack.empty()) {
+      if(_pool == NULL) { _pool = new oto_thread_pool(_nthreads); }
+      l0.nstack = l0.stack.size();
+      __atomic_store_n(&_pending,(long) l0.stack.size(),__ATOMIC_RELAXED);
+      _pool->run(worker,this);
+#ifdef PAR_GENERATE_STATS
+      ++par_nsearches;
+#endif
+    }
+
+    // gather the results and reset
+    for(unsigned int i=0;i!=_locals.size();++i) {
+      local_t &l(*_locals[i]);
+      for(typename std::vector<vd_t>::iterator j(l.found.begin());
+	  j!=l.found.end();++j) {
+	_claimed[*j] = 0;
+      }
+      if(!cycle()) {
+	reachable.insert(reachable.end(),l.found.begin(),l.found.end());
+      }
+      nvisits += l.nvisits;
+      l.nvisits = 0;
+      l.found.clear();
+      l.stack.clear();
+      l.nstack = 0;
+    }
+
+    return cycle();
+  }
+private:
+  void release(void) {
+    delete _pool;
+    _pool = NULL;
+    for(unsigned int i=0;i!=_locals.size();++i) {
+      delete _locals[i];
+    }
+    _locals.clear();
+  }
+
+  static void worker(void *arg, unsigned int id) {
+    ((par_bounded_search *) arg)->work(id);
+  }
+
+  void work(unsigned int id) {
+    local_t &l(*_locals[id]);
+    vd_t n;
+
+    while(!cycle()) {
+      if(!pop(l,n) && !steal(id,n)) {
+	if(__atomic_load_n(&_pending,__ATOMIC_ACQUIRE) == 0) { break; }
+	sched_yield();
+	continue;
+      }
+      expand(n,l);
+      if(!l.buffer.empty()) {
+	pthread_mutex_lock(&l.lock);
+	l.stack.insert(l.stack.end(),l.buffer.begin(),l.buffer.end());
+	__atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+	pthread_mutex_unlock(&l.lock);
+      }
+      // n is done, but its successors are now pending.
+      __atomic_fetch_add(&_pending,((long) l.buffer.size()) - 1,
+			 __ATOMIC_ACQ_REL);
+    }
+  }
+
+  void expand(vd_t n, local_t &l) {
+    N2iMap &n2i(*_n2i);
+    l.buffer.clear();
+    ++l.nvisits;
+    out_iterator i,iend;
+    for(tie(i,iend) = out_edges(n,*_g); i!=iend;++i) {
+      vd_t w(target(*i,*_g));
+      unsigned int wn2i(n2i[w]);
+      ++l.nvisits;
+      if(wn2i == _ub) {
+	// this is the special case
+	// where a cycle has been detected
+	__atomic_store_n(&_cycle,1,__ATOMIC_RELAXED);
+	return;
+      } else if(wn2i < _ub && claim(w)) {
+	l.found.push_back(w);
+	l.buffer.push_back(w);
+      }
+    }
+  }
+
+  bool cycle() const {
+    return __atomic_load_n(&_cycle,__ATOMIC_RELAXED) != 0;
+  }
+
+  // claim w for this thread; the cheap load first
+  // avoids a locked operation on nodes already taken.
+  bool claim(vd_t w) {
+    unsigned char expected(0);
+    return __atomic_load_n(&_claimed[w],__ATOMIC_RELAXED) == 0 &&
+      __atomic_compare_exchange_n(&_claimed[w],&expected,1,false,
+				  __ATOMIC_ACQ_REL,__ATOMIC_RELAXED);
+  }
+
+  bool pop(local_t &l, vd_t &n) {
+    bool r(false);
+    pthread_mutex_lock(&l.lock);
+    if(!l.stack.empty()) {
+      n = l.stack.back();
+      l.stack.pop_back();
+      __atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+      r = true;
+    }
+    pthread_mutex_unlock(&l.lock);
+    return r;
+  }
+
+  bool steal(unsigned int id, vd_t &n) {
+    local_t &l(*_locals[id]);
+    for(unsigned int k=1;k!=_locals.size();++k) {
+      local_t &v(*_locals[(id+k) % _locals.size()]);
+      if(__atomic_load_n(&v.nstack,__ATOMIC_RELAXED) == 0) { continue; }
+      pthread_mutex_lock(&v.lock);
+      unsigned int size(v.stack.size());
+      if(size == 0) {
+	pthread_mutex_unlock(&v.lock);
+	continue;
+      }
+      // take half of the victim's worklist
+      unsigned int half((size+1) / 2);
+      l.buffer.assign(v.stack.end()-half,v.stack.end());
+      v.stack.resize(size-half);
+      __atomic_store_n(&v.nstack,v.stack.size(),__ATOMIC_RELAXED);
+      pthread_mutex_unlock(&v.lock);
+
+      n = l.buffer.back();
+      l.buffer.pop_back();
+      if(!l.buffer.empty()) {
+	pthread_mutex_lock(&l.lock);
+	l.stack.insert(l.stack.end(),l.buffer.begin(),l.buffer.end());
+	__atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+	pthread_mutex_unlock(&l.lock);
+      }
+      return true;
+    }
+    return false;
+  }
+};
+
+#endif
@@ -0,0 +1,293 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// An offline topological sort which can use several threads.  This
+// is Kahn's algorithm: a node is ready once all of its predecessors
+// have been placed, and ready nodes are placed in any order.  It is
+// done in three passes, each split evenly over the threads by node:
+//
+//   1) count the in-degree of each node, with atomic increments;
+//   2) put each node with no predecessors on its thread's worklist;
+//   3) take nodes from the worklists, giving each the next index with
+//      an atomic increment, and then decrement the in-degree of its
+//      successors.  Any which reach zero are ready, and are pushed.
+//
+// A node's index is taken before any of its successors become ready,
+// so it is always lower than theirs.  As for par_bounded_search, idle
+// threads steal half of another thread's worklist, and the sort is
+// over when the count of pending nodes drops to zero.  If some nodes
+// were never placed, then the graph has a cycle.
+//
+// As there, the counters shared between the threads (the in-degrees,
+// the next index, the pending count and the worklist size hints) are
+// read and written with the __atomic builtins, and only the worklists
+// themselves are guarded by their locks.
+//
+// Graphs with no more nodes than the threshold are sorted on the
+// calling thread alone, without any of the atomic operations or
+// locking.
+
+#ifndef PARALLEL_TOPOLOGICAL_SORT_HPP
+#define PARALLEL_TOPOLOGICAL_SORT_HPP
+
+#include <vector>
+#include <sched.h>
+#include <pthread.h>
+#include "thread_pool.hpp"
+
+// the number of nodes above which
+// the helper threads are brought in.
+#define PAR_SORT_DEFAULT_THRESHOLD 4096
+
+template<class G>
+class par_topological_sort {
+public:
+  typedef typename G::vertex_descriptor vd_t;
+private:
+  typedef typename G::out_edge_iterator out_iterator;
+
+  enum { COUNT, SEED, SORT };
+
+  struct local_t {
+    pthread_mutex_t lock;
+    std::vector<vd_t> stack;
+    std::vector<vd_t> buffer; // successors made ready
+    unsigned int nstack; // size of stack, readable without the lock
+    char pad[64]; // keep locals on separate cache lines
+
+    local_t() : nstack(0) { pthread_mutex_init(&lock,NULL); }
+    ~local_t() { pthread_mutex_destroy(&lock); }
+  };
+
+  unsigned int _nthreads;
+  unsigned int _threshold;
+  oto_lazy_pool _pool;
+  std::vector<local_t*> _locals;
+  std::vector<int> _indeg;
+  std::vector<vd_t> _order;
+
+  // state of the current sort
+  G const *_g;
+  unsigned int _nactive; // threads taking part
+  unsigned int _phase;
+  unsigned int _next;
+  long _pending;
+public:
+  par_topological_sort(unsigned int nthreads = 1,
+		       unsigned int threshold = PAR_SORT_DEFAULT_THRESHOLD)
+    : _nthreads(nthreads), _threshold(threshold), _pool(nthreads) {
+  }
+
+  // copying only copies the settings; the threads
+  // and scratch space are created again on demand.
+  par_topological_sort(par_topological_sort const &src)
+    : _nthreads(src._nthreads), _threshold(src._threshold),
+      _pool(src._nthreads) {
+  }
+
+  ~par_topological_sort() {
+    release();
+  }
+
+  void operator=(par_topological_sort const &src) {
+    if(&src != this) {
+      configure(src._nthreads,src._threshold);
+    }
+  }
+
+  void configure(unsigned int nthreads, unsigned int threshold) {
+    if(nthreads != _nthreads) {
+      release();
+      _pool = oto_lazy_pool(nthreads);
+    }
+    _nthreads = nthreads;
+    _threshold = threshold;
+  }
+
+  bool active(void) const { return _nthreads > 1; }
+
+  // Sort g, setting i2n (which must have room for every node) and
+  // n2i.  Returns false, leaving both unchanged, if g has a cycle.
+
+  template<class I2nMap, class N2iMap>
+  bool sort(G const &g, I2nMap &i2n, N2iMap n2i) {
+    unsigned int n(num_vertices(g));
+    _g = &g;
+    _indeg.assign(n,0);
+    _order.resize(n);
+    __atomic_store_n(&_next,0,__ATOMIC_RELAXED);
+    _nactive = 1;
+    if(_nthreads > 1 && n > _threshold) { _nactive = _pool.get().size(); }
+    while(_locals.size() < _nactive) { _locals.push_back(new local_t()); }
+
+    run(COUNT);
+    run(SEED);
+    long pending(0);
+    for(unsigned int i=0;i!=_nactive;++i) {
+      pending += _locals[i]->stack.size();
+    }
+    __atomic_store_n(&_pending,pending,__ATOMIC_RELAXED);
+    run(SORT);
+
+    if(__atomic_load_n(&_next,__ATOMIC_RELAXED) != n) { return false; }
+    for(unsigned int i=0;i!=n;++i) {
+      i2n[i] = _order[i];
+      n2i[_order[i]] = i;
+    }
+    return true;
+  }
+private:
+  void release(void) {
+    for(unsigned int i=0;i!=_locals.size();++i) {
+      delete _locals[i];
+    }
+    _locals.clear();
+  }
+
+  void run(unsigned int phase) {
+    _phase = phase;
+    if(_nactive > 1) {
+      _pool.get().run(worker,this);
+    } else {
+      work(0);
+    }
+  }
+
+  static void worker(void *arg, unsigned int id) {
+    ((par_topological_sort *) arg)->work(id);
+  }
+
+  void work(unsigned int id) {
+    G const &g(*_g);
+    unsigned int n(num_vertices(g));
+    // this thread's share of the nodes
+    vd_t b((vd_t) (((unsigned long long) n * id) / _nactive));
+    vd_t e((vd_t) (((unsigned long long) n * (id+1)) / _nactive));
+    local_t &l(*_locals[id]);
+
+    if(_nactive == 1) {
+      sequential(l);
+    } else if(_phase == COUNT) {
+      for(vd_t v=b;v!=e;++v) {
+	out_iterator i,iend;
+	for(tie(i,iend) = out_edges(v,g);i!=iend;++i) {
+	  __atomic_fetch_add(&_indeg[target(*i,g)],1,__ATOMIC_RELAXED);
+	}
+      }
+    } else if(_phase == SEED) {
+      for(vd_t v=b;v!=e;++v) {
+	if(_indeg[v] == 0) { l.stack.push_back(v); }
+      }
+      __atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+    } else {
+      vd_t v;
+      while(true) {
+	if(!pop(l,v) && !steal(id,v)) {
+	  if(__atomic_load_n(&_pending,__ATOMIC_ACQUIRE) == 0) { break; }
+	  sched_yield();
+	  continue;
+	}
+	_order[__atomic_fetch_add(&_next,1,__ATOMIC_RELAXED)] = v;
+	l.buffer.clear();
+	out_iterator i,iend;
+	for(tie(i,iend) = out_edges(v,g);i!=iend;++i) {
+	  vd_t w(target(*i,g));
+	  if(__atomic_sub_fetch(&_indeg[w],1,__ATOMIC_ACQ_REL) == 0) {
+	    l.buffer.push_back(w);
+	  }
+	}
+	if(!l.buffer.empty()) {
+	  pthread_mutex_lock(&l.lock);
+	  l.stack.insert(l.stack.end(),l.buffer.begin(),l.buffer.end());
+	  __atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+	  pthread_mutex_unlock(&l.lock);
+	}
+	// v is done, but its ready successors are now pending.
+	__atomic_fetch_add(&_pending,((long) l.buffer.size()) - 1,
+			   __ATOMIC_ACQ_REL);
+      }
+    }
+  }
+
+  void sequential(local_t &l) {
+    G const &g(*_g);
+    unsigned int n(num_vertices(g));
+    if(_phase == COUNT) {
+      for(vd_t v=0;v!=n;++v) {
+	out_iterator i,iend;
+	for(tie(i,iend) = out_edges(v,g);i!=iend;++i) {
+	  ++_indeg[target(*i,g)];
+	}
+      }
+    } else if(_phase == SEED) {
+      for(vd_t v=0;v!=n;++v) {
+	if(_indeg[v] == 0) { l.stack.push_back(v); }
+      }
+    } else {
+      while(!l.stack.empty()) {
+	vd_t v(l.stack.back());
+	l.stack.pop_back();
+	_order[_next++] = v;
+	out_iterator i,iend;
+	for(tie(i,iend) = out_edges(v,g);i!=iend;++i) {
+	  vd_t w(target(*i,g));
+	  if(--_indeg[w] == 0) { l.stack.push_back(w); }
+	}
+      }
+    }
+  }
+
+  bool pop(local_t &l, vd_t &v) {
+    bool r(false);
+    pthread_mutex_lock(&l.lock);
+    if(!l.stack.empty()) {
+      v = l.stack.back();
+      l.stack.pop_back();
+      __atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+      r = true;
+    }
+    pthread_mutex_unlock(&l.lock);
+    return r;
+  }
+
+  bool steal(unsigned int id, vd_t &v) {
+    local_t &l(*_locals[id]);
+    for(unsigned int k=1;k!=_nactive;++k) {
+      local_t &o(*_locals[(id+k) % _nactive]);
+      // the size is only a hint, and is checked again under the lock
+      if(__atomic_load_n(&o.nstack,__ATOMIC_RELAXED) == 0) { continue; }
+      pthread_mutex_lock(&o.lock);
+      unsigned int size(o.stack.size());
+      if(size == 0) {
+	pthread_mutex_unlock(&o.lock);
+	continue;
+      }
+      // take half of the victim's worklist
+      unsigned int half((size+1) / 2);
+      l.buffer.assign(o.stack.end()-half,o.stack.end());
+      o.stack.resize(size-half);
+      __atomic_store_n(&o.nstack,o.stack.size(),__ATOMIC_RELAXED);
+      pthread_mutex_unlock(&o.lock);
+
+      v = l.buffer.back();
+      l.buffer.pop_back();
+      if(!l.buffer.empty()) {
+	pthread_mutex_lock(&l.lock);
+	l.stack.insert(l.stack.end(),l.buffer.begin(),l.buffer.end());
+	__atomic_store_n(&l.nstack,l.stack.size(),__ATOMIC_RELAXED);
+	pthread_mutex_unlock(&l.lock);
+      }
+      return true;
+    }
+    return false;
+  }
+};
+
+#endif
@@ -9,26 +9,34 @@
 #ifndef PATH_HPP
 #define PATH_HPP
 
+#include <vector>
+#include <utility>
+#include "visit_marks.hpp"
+#include "interleaved_search.hpp"
+
+// This version uses the scratch space provided, so that
+// repeated queries on the same graph need not allocate.
+// visited must have room for every vertex of g.
+
 template<class T>
 bool path(typename T::vertex_descriptor from, 
 	  typename T::vertex_descriptor to,
-	  T const &g) {
+	  T const &g, visit_marks &visited,
+	  std::vector<typename T::vertex_descriptor> &worklist) {
 
   // some useful typedefs
   typedef typename T::vertex_descriptor vd_t;
   typedef typename T::out_edge_iterator oiterator;
 
   // now the actual code.
-  // create worklist and guess at
-  // likely max size
-  std::vector<vd_t> worklist;    
   // NOTE: this will _not_ work if a
   //       graph with non_integer vertex_descriptors
   //       is used.
-  std::vector<bool> visited(num_vertices(g));
+  worklist.clear();
+  visited.clear();
 
   // mark node h as visited  
-  visited[from]=true;
+  visited.mark(from);
   worklist.push_back(from);
   
   // now perform the depth-first-search
@@ -42,8 +50,8 @@ bool path(typename T::vertex_descriptor from,
       oiterator i,iend;
       for(tie(i,iend) = out_edges(n,g); i!=iend;++i) {
 	vd_t t(target(*i,g));
-	if(!visited[t]) {
-	  visited[t]=true;
+	if(!visited.marked(t)) {
+	  visited.mark(t);
 	  worklist.push_back(t);
 	}
       }
@@ -53,4 +61,44 @@ bool path(typename T::vertex_descriptor from,
   return false;
 }
 
+template<class T>
+bool path(typename T::vertex_descriptor from, 
+	  typename T::vertex_descriptor to,
+	  T const &g) {
+  // create worklist and visited 
+  // marks for this query only.
+  std::vector<typename T::vertex_descriptor> worklist;    
+  visit_marks visited(num_vertices(g));
+  return path(from,to,g,visited,worklist);
+}
+
+// Answers a whole batch of path queries, running as many of them
+// together as the search has lanes (see interleaved_search.hpp).
+// The n2i map is only used to find the vertex records, so that
+// they can be prefetched.  The search must not share its marks.
+
+template<class T, class N2iMap>
+void paths(std::vector<std::pair<typename T::vertex_descriptor,
+	                         typename T::vertex_descriptor> > const &queries,
+	   std::vector<bool> &results, T const &g, N2iMap n2i,
+	   interleaved_search<T,N2iMap,isearch_path<T> > &search) {
+  results.resize(queries.size());
+  unsigned int i(0);
+  while(i != queries.size()) {
+    unsigned int start(i);
+    search.reset(g,n2i);
+    for(;i!=queries.size() && !search.full();++i) {
+      unsigned int k(search.add_lane());
+      if(queries[i].first != queries[i].second) {
+	search.add_root(k,queries[i].first,queries[i].second);
+      }
+    }
+    search.run();
+    for(unsigned int j=start;j!=i;++j) {
+      results[j] = queries[j].first == queries[j].second 
+	|| search.stopped_early(j-start);
+    }
+  }
+}
+
 #endif
@@ -27,9 +27,21 @@
 #define POTO1_ONLINE_TOPOLOGICAL_ORDER_HPP
 
 #include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <boost/cstdint.hpp>
 #include <boost/property_map.hpp>
 #include <boost/graph/topological_sort.hpp>
 #include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "thread_pool.hpp"
+#include "parallel_reachability.hpp"
+#include "parallel_topological_sort.hpp"
+#include "visit_marks.hpp"
+#include "interleaved_search.hpp"
+#include "dfs_frame.hpp"
+#include "work_budget.hpp"
 
 // these globals are not strictly needed
 // they are used to generate the metrics
@@ -37,121 +49,367 @@
 extern unsigned int poto1_dxy;
 extern unsigned int poto1_ddxy;
 extern unsigned int poto1_ninvalid;
+extern unsigned int poto1_ARxy;
 #endif
 
 template<class T, class N2I>
 class poto1_online_topological_order;
 
-template<class N2I>
-class poto1_oto_comp {
-private:
-  N2I _n2i;
-public:
-  poto1_oto_comp(N2I p)
-    : _n2i(p) {
+// Below this many nodes, the affected
+// sets are insertion sorted.
+#define POTO1_RADIX_THRESHOLD 64
+
+// the window size above which the two searches
+// are run concurrently, when this is turned on.
+#define POTO1_CONCURRENT_THRESHOLD 1024
+
+// Sort the nodes by their position in the order.  Each node is
+// packed together with its index into a 64-bit key (index in the
+// upper half), so that sorting needs no indirect lookups of n2i.
+// Since all of the indices lie in [lb,ub], only the digits needed
+// to distinguish ub-lb values are radix sorted.
+
+template<class N2iMap>
+void poto1_oto_sort(std::vector<unsigned int> const &nodes,
+		    unsigned int lb, unsigned int ub, N2iMap n2i,
+		    std::vector<boost::uint64_t> &keys,
+		    std::vector<boost::uint64_t> &buf) {
+  keys.clear();
+  for(std::vector<unsigned int>::const_iterator i(nodes.begin());
+      i!=nodes.end();++i) {
+    keys.push_back((((boost::uint64_t) n2i[*i]) << 32) | *i);
   }
 
-  bool operator()(unsigned int x, unsigned int y) const {
-    return _n2i[x] < _n2i[y];
+  if(keys.size() < POTO1_RADIX_THRESHOLD) {
+    for(unsigned int i=1;i<keys.size();++i) {
+      boost::uint64_t k(keys[i]);
+      unsigned int j(i);
+      for(;j > 0 && keys[j-1] > k;--j) {
+	keys[j] = keys[j-1];
+      }
+      keys[j] = k;
+    }
+    return;
   }
-};
 
-template<class T, class N2I> 
+  // LSD radix sort, 8 bits at a time
+  unsigned int range(ub - lb);
+  buf.resize(keys.size());
+  for(unsigned int shift=0;shift < 32 && (range >> shift) != 0;shift += 8) {
+    unsigned int count[257];
+    std::fill(count,count+257,0);
+    for(unsigned int i=0;i!=keys.size();++i) {
+      ++count[((((unsigned int) (keys[i] >> 32)) - lb) >> shift & 0xFF) + 1];
+    }
+    for(unsigned int d=1;d!=257;++d) {
+      count[d] += count[d-1];
+    }
+    for(unsigned int i=0;i!=keys.size();++i) {
+      buf[count[(((unsigned int) (keys[i] >> 32)) - lb) >> shift & 0xFF]++] = keys[i];
+    }
+    keys.swap(buf);
+  }
+}
+
+// The stack always holds a path from n, so if cycle is
+// given, it is set to that path on reaching ub.  The two searches
+// and the reorder only touch the members they use, so G can be
+// any class which has them (HYBRID borrows them too).
+
+template<class T, class N2I, class G> 
 bool poto1_oto_fwd_dfs(typename T::vertex_descriptor n, 
 		       typename T::vertex_descriptor ub, 
 		       std::vector<unsigned int> &reachable,
 		       typename boost::property_map<T, N2I>::type n2i,		 
-		       poto1_online_topological_order<T,N2I> &g) {
+		       G &g,
+		       std::vector<typename T::vertex_descriptor> *cycle) {
   typedef typename T::out_edge_iterator out_iterator;
+  typedef dfs_frame<typename T::vertex_descriptor,out_iterator> frame;
+
+  // the stack is kept between calls
+  std::vector<frame> &stack(g._fwdstack);
+  stack.clear();
 
+  // the work done is recorded in _fwdwork, and
+  // the search gives up if it exceeds the budget.
+  unsigned int work(1);
+  unsigned int allowance(g._budget.remaining());
   reachable.push_back(n);
-  g._visited[n]=true;
+  g._visited.mark(n);
 #ifdef POTO1_GENERATE_STATS
   ++poto1_ddxy;
 #endif
-  out_iterator i,iend;
-  for(tie(i,iend) = out_edges(n,g); i!=iend;++i) {
-    unsigned int w(target(*i,g));
+  stack.push_back(frame(n,out_edges(n,g)));
+
+  while(!stack.empty()) {
+    if(work > allowance) { break; }
+    frame &f(stack.back());
+    if(f.i == f.iend) {
+      stack.pop_back();
+      continue;
+    }
+    unsigned int w(target(*f.i,g));
     unsigned int wn2i(n2i[w]);
+    ++f.i;
     if(wn2i == ub) {
       // this is the special case
       // where a cycle has been detected
+      g._fwdwork = work;
+      if(cycle != NULL) {
+	cycle->clear();
+	for(unsigned int i=0;i!=stack.size();++i) {
+	  cycle->push_back(stack[i].v);
+	}
+	cycle->push_back(w);
+      }
       return true;
-    } else if(wn2i < ub && !g._visited[w]) {
-      poto1_oto_fwd_dfs(w,ub,reachable,n2i,g);
+    } else if(wn2i < ub && !g._visited.marked(w)) {
+      reachable.push_back(w);
+      g._visited.mark(w);
+      ++work;
+#ifdef POTO1_GENERATE_STATS
+      ++poto1_ddxy;
+#endif
+      stack.push_back(frame(w,out_edges(w,g)));
     }
+    ++work;
 #ifdef POTO1_GENERATE_STATS
     ++poto1_ddxy;
 #endif
   }
+  g._fwdwork = work;
   return false;
 }
 
-template<class T, class N2I> 
+template<class T, class N2I, class G> 
 void poto1_oto_back_dfs(typename T::vertex_descriptor n, 
 			typename T::vertex_descriptor lb, 
 			std::vector<unsigned int> &reaching,
 			typename boost::property_map<T, N2I>::type n2i,		 
-			poto1_online_topological_order<T,N2I> &g) {
+			G &g) {
 
   typedef typename T::in_edge_iterator in_iterator;
+  typedef dfs_frame<typename T::vertex_descriptor,in_iterator> frame;
+
+  // the stack is kept between calls
+  std::vector<frame> &stack(g._backstack);
+  stack.clear();
 
+  // The backward search has its own marks, and counts its visits
+  // separately, since it may run alongside the forward search.
+  // If so, it gives up as soon as that finds a cycle.
+  visit_marks &visited(g._backvisited);
+  unsigned int nvisits(1);
+  unsigned int allowance(g._budget.remaining());
+  visited.clear();
   reaching.push_back(n);
-  g._visited[n]=true;
-#ifdef POTO1_GENERATE_STATS
-  ++poto1_ddxy;
-#endif
-  in_iterator i,iend;
-  for(tie(i,iend) = in_edges(n,g); i!=iend;++i) {
-    unsigned int w(source(*i,g));
+  visited.mark(n);
+  stack.push_back(frame(n,in_edges(n,g)));
+
+  while(!stack.empty() && !__atomic_load_n(&g._cancel,__ATOMIC_ACQUIRE) &&
+	nvisits <= allowance) {
+    frame &f(stack.back());
+    if(f.i == f.iend) {
+      stack.pop_back();
+      continue;
+    }
+    unsigned int w(source(*f.i,g));
     unsigned int wn2i(n2i[w]);
-    if(wn2i > lb && !g._visited[w]) {
-      poto1_oto_back_dfs(w,lb,reaching,n2i,g);
+    ++f.i;
+    if(wn2i > lb && !visited.marked(w)) {
+      reaching.push_back(w);
+      visited.mark(w);
+      ++nvisits;
+      stack.push_back(frame(w,in_edges(w,g)));
     }
-#ifdef POTO1_GENERATE_STATS
-    ++poto1_ddxy;
-#endif
+    ++nvisits;
   }
+  g._backvisits = nvisits;
 }
 
+// Runs the forward search on the calling thread (id 0) and the
+// backward search on the helper (id 1).  The two only read the
+// graph and n2i, and write to disjoint state.
+
 template<class T, class N2I>
-void poto1_oto_reorder(std::vector<unsigned int> &reachable,
-		   std::vector<unsigned int> &reaching,
-		   typename boost::property_map<T, N2I>::type n2i, 
-		   poto1_online_topological_order<T,N2I> &g) {    
-  std::vector<typename T::vertex_descriptor> tmp;
-  tmp.reserve(reaching.size() + reachable.size());
-  std::vector<unsigned int>::iterator iend(reaching.end());
-  for(std::vector<unsigned int>::iterator i(reaching.begin());
-      i!=iend;++i) {
-    tmp.push_back(*i);
-    g._visited[*i]=false;
-    *i = n2i[*i]; // dirty trick
-  }
-  iend=reachable.end();
-  for(std::vector<unsigned int>::iterator i(reachable.begin());
-      i!=iend;++i) {   
-    tmp.push_back(*i);
-    g._visited[*i]=false;
-    *i = n2i[*i]; // dirty trick
+struct poto1_oto_job {
+  poto1_online_topological_order<T,N2I> *g;
+  typename T::vertex_descriptor t;
+  typename T::vertex_descriptor h;
+  unsigned int hn2i;
+  unsigned int tn2i;
+  bool cycle;
+};
+
+template<class T, class N2I>
+void poto1_oto_both(void *arg, unsigned int id) {
+  poto1_oto_job<T,N2I> &j(*((poto1_oto_job<T,N2I> *) arg));
+  poto1_online_topological_order<T,N2I> &g(*j.g);
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  if(id == 0) {
+    j.cycle = poto1_oto_fwd_dfs<T,N2I>(j.h,j.tn2i,g._reachable,n2i,g,NULL);
+    if(j.cycle) { __atomic_store_n(&g._cancel,1,__ATOMIC_RELEASE); }
+  } else if(id == 1) {
+    poto1_oto_back_dfs<T,N2I>(j.t,j.hn2i,g._reaching,n2i,g);
   }
-  std::vector<unsigned int>::iterator i(reachable.begin());
-  std::vector<unsigned int>::iterator j(reaching.begin());
-  std::vector<unsigned int>::iterator jend(reaching.end());
+}
+
+// The sorted keys give the indices to be reused.  Merging them
+// gives the free slots in order, and these are handed out first to
+// the nodes of reaching and then to those of reachable.
+
+template<class T, class N2I, class G>
+void poto1_oto_reorder(std::vector<boost::uint64_t> const &reachable,
+		       std::vector<boost::uint64_t> const &reaching,
+		       typename boost::property_map<T, N2I>::type n2i, 
+		       G &g) {    
+  typedef std::vector<boost::uint64_t>::const_iterator iterator;
+  iterator i(reachable.begin());
+  iterator iend(reachable.end());
+  iterator j(reaching.begin());
+  iterator jend(reaching.end());
   unsigned int index(0);
   while(i != iend || j != jend) {
     unsigned int w;
     if(j == jend || (i != iend && *i < *j)) {
-      w=*i;++i;
+      w=(unsigned int) (*i >> 32);++i;
     } else {
-      w=*j;++j;
+      w=(unsigned int) (*j >> 32);++j;
     }
-    typename T::vertex_descriptor n(tmp[index++]);
+    boost::uint64_t k;
+    if(index < reaching.size()) {
+      k = reaching[index];
+    } else {
+      k = reachable[index - reaching.size()];
+    }
+    ++index;
     // allocate n at w
-    n2i[n]=w;
+    n2i[(unsigned int) k]=w;
+    g._i2n[w]=(unsigned int) k;
   }  
 }
 
+// Sort the whole graph again, when a search has gone over budget.
+// Returns false, leaving the order alone, if there is a cycle.
+
+template<class T, class N2I>
+bool poto1_oto_resort(typename boost::property_map<T, N2I>::type n2i, 
+		      poto1_online_topological_order<T,N2I> &g) {
+  unsigned int cost;
+  if(!offline_topological_sort(static_cast<T const &>(g),g._order,g._sortmarks,
+			       g._done,g._sortstack,cost)) {
+    return false;
+  }
+  for(unsigned int i=0;i!=g._order.size();++i) {
+    g._i2n[i]=g._order[i];
+    n2i[g._order[i]]=i;
+  }
+  g._budget.fallback(cost);
+#ifdef POTO1_GENERATE_STATS
+  poto1_ddxy += cost;
+#endif
+  return true;
+}
+
+// Bring the order up to date once t->h has gone into the
+// underlying graph.  Returns false, leaving the order as
+// it was, if t->h closes a cycle (which is put in witness,
+// if given).
+
+template<class T, class N2I>
+bool poto1_oto_insert(typename T::vertex_descriptor t, 
+		      typename T::vertex_descriptor h, 
+		      poto1_online_topological_order<T,N2I> &g,
+		      std::vector<typename T::vertex_descriptor> *witness) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  unsigned int hn2i(n2i[h]);
+  unsigned int tn2i(n2i[t]);
+
+  if(hn2i < tn2i) {
+    // need to reorder
+    std::vector<unsigned int> &reaching(g._reaching);
+    std::vector<unsigned int> &reachable(g._reachable);
+    bool cycle;
+    reaching.clear();
+    reachable.clear();
+    g._visited.clear();
+    // no search is running yet, and the pool
+    // orders this before the helper starts.
+    __atomic_store_n(&g._cancel,0,__ATOMIC_RELAXED);
+    g._budget.start(num_vertices(g),num_edges(g));
+    bool searched_back(false);
+    if(witness != NULL) {
+      // the forward search alone, and in full
+      g._budget.lift();
+      cycle = poto1_oto_fwd_dfs<T,N2I>(h,tn2i,reachable,n2i,g,witness);
+    } else if(g._par.active(tn2i - hn2i)) {
+      // large affected regions are
+      // searched in parallel.
+      g._budget.lift();
+      unsigned int nvisits(0);
+      cycle = g._par.search(h,tn2i,g,n2i,reachable,nvisits);
+      for(std::vector<unsigned int>::iterator i(reachable.begin());
+	  i!=reachable.end();++i) {
+	g._visited.mark(*i);
+      }
+#ifdef POTO1_GENERATE_STATS
+      poto1_ddxy += nvisits;
+#endif
+    } else if(g._concurrent && tn2i - hn2i > g._cthreshold) {
+      // search both ways at once
+      g._budget.lift();
+      poto1_oto_job<T,N2I> job;
+      job.g = &g;
+      job.t = t;
+      job.h = h;
+      job.hn2i = hn2i;
+      job.tn2i = tn2i;
+      job.cycle = false;
+      g._cpool.get().run(poto1_oto_both<T,N2I>,&job);
+      cycle = job.cycle;
+      searched_back = true;
+#ifdef POTO1_GENERATE_STATS
+      poto1_ddxy += g._backvisits;
+#endif
+    } else {
+      cycle = poto1_oto_fwd_dfs<T,N2I>(h,tn2i,reachable,n2i,g,NULL);
+      g._budget.charge(g._fwdwork);
+    }
+    if(cycle) {
+      return false;
+    } else {
+      if(!searched_back && !g._budget.exceeded()) {
+	poto1_oto_back_dfs<T,N2I>(t,hn2i,reaching,n2i,g);
+	g._budget.charge(g._backvisits);
+#ifdef POTO1_GENERATE_STATS
+	poto1_ddxy += g._backvisits;
+#endif
+      }
+#ifdef POTO1_GENERATE_STATS
+      // as for MNR, an edge handed to the
+      // fallback still counts as invalidating.
+      ++poto1_ninvalid;
+      poto1_ARxy += (tn2i - hn2i + 1);
+#endif
+      if(g._budget.exceeded()) {
+	return poto1_oto_resort(n2i,g);
+      }
+      g._budget.completed(reaching.size() + reachable.size());
+      poto1_oto_sort(reaching,hn2i,tn2i,n2i,g._reachingkeys,g._keybuf);
+      poto1_oto_sort(reachable,hn2i,tn2i,n2i,g._reachablekeys,g._keybuf);
+      poto1_oto_reorder<T,N2I>(g._reachablekeys,g._reachingkeys,n2i,g);
+#ifdef POTO1_GENERATE_STATS
+      poto1_dxy += reaching.size() + reachable.size();
+#endif
+    }
+  }
+  return true;
+}
+
 template<class T, class N2I>
 std::pair<typename T::edge_descriptor, bool> 
 add_edge(typename poto1_online_topological_order<T,N2I>::vertex_descriptor t, 
@@ -162,36 +420,170 @@ add_edge(typename poto1_online_topological_order<T,N2I>::vertex_descriptor t,
 	       static_cast<typename T::vertex_descriptor>(h),
 	       static_cast<T&>(g));
 
-  typedef typename boost::property_map<T, N2I>::type N2iMap;
-  N2iMap n2i = get(N2I(),g);
+  if(r.second && !poto1_oto_insert<T,N2I>(t,h,g,NULL)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    throw std::runtime_error("loop detected");
+  }
+  return r;
+}
 
-  unsigned int hn2i(n2i[h]);
-  unsigned int tn2i(n2i[t]);
+template<class T, class N2I>
+oto_status
+try_add_edge(typename poto1_online_topological_order<T,N2I>::vertex_descriptor t, 
+	     typename poto1_online_topological_order<T,N2I>::vertex_descriptor h, 
+	     poto1_online_topological_order<T,N2I> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!poto1_oto_insert<T,N2I>(t,h,g,NULL)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
 
-  if(r.second && hn2i < tn2i) {
-    // need to reorder
-    std::vector<unsigned int> reaching, reachable;
-    if(poto1_oto_fwd_dfs<T,N2I>(h,tn2i,reachable,n2i,g)) {
+template<class T, class N2I>
+oto_status
+try_add_edge(typename poto1_online_topological_order<T,N2I>::vertex_descriptor t, 
+	     typename poto1_online_topological_order<T,N2I>::vertex_descriptor h, 
+	     poto1_online_topological_order<T,N2I> &g,
+	     std::vector<typename T::vertex_descriptor> &cycle) {
+  cycle.clear();
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s == OTO_CYCLE) { cycle.push_back(h); }
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(!poto1_oto_insert<T,N2I>(t,h,g,&cycle)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
+// When interleaving is turned on, the searches for a batch are
+// run together.  As for MNR, invalidating edges are collected
+// until an edge touches the affected region of one already
+// collected, so the regions are disjoint and the outcome is the
+// same as inserting the edges one at a time.  The forward
+// searches are run first, followed by the backward ones.
+
+template<class T, class N2I>
+void poto1_oto_flush(typename boost::property_map<T, N2I>::type n2i, 
+		     poto1_online_topological_order<T,N2I> &g) {    
+  typedef typename std::vector<std::pair<unsigned int, typename T::vertex_descriptor> >::const_iterator found_iterator;
+
+  if(g._windows.empty()) { return; }
+
+  g._fwd.run();
+  g._back.reset(g,n2i);
+  for(unsigned int k=0;k!=g._windows.size();++k) {
+    unsigned int j(g._back.add_lane());
+    g._back.add_root(j,source(g._inserted[g._lanepos[k]],g),
+		     g._windows[k].first);
+  }
+  g._back.run();
+
+  for(unsigned int k=0;k!=g._windows.size();++k) {
+#ifdef POTO1_GENERATE_STATS
+    poto1_ddxy += g._fwd.nvisits(k);
+#endif
+    if(g._fwd.stopped_early(k)) {
+      // this edge closes a cycle, and those after it
+      // were never really inserted, so take them all out
+      // again.  Removing by descriptor leaves any parallel
+      // copies that were already present in place.
+      for(unsigned int j=g._inserted.size();j!=g._lanepos[k];--j) {
+	remove_edge(g._inserted[j-1],static_cast<T&>(g));
+      }
+      g._windows.clear();
+      g._lanepos.clear();
+      g._inserted.clear();
       throw std::runtime_error("loop detected");
-    } else {
-      poto1_oto_back_dfs<T,N2I>(t,hn2i,reaching,n2i,g);
-      poto1_oto_comp<N2iMap> pc(n2i);
-      sort(reaching.begin(),reaching.end(),pc);
-      sort(reachable.begin(),reachable.end(),pc);
-      poto1_oto_reorder(reachable,reaching,n2i,g);
+    }
 #ifdef POTO1_GENERATE_STATS
-      ++poto1_ninvalid;
-      poto1_dxy += reaching.size() + reachable.size();
+    poto1_ddxy += g._back.nvisits(k);
 #endif
+    std::vector<unsigned int> &reaching(g._reaching);
+    std::vector<unsigned int> &reachable(g._reachable);
+    reaching.clear();
+    reachable.clear();
+    for(found_iterator i(g._fwd.found(k).begin());i!=g._fwd.found(k).end();++i) {
+      reachable.push_back(i->second);
+    }
+    for(found_iterator i(g._back.found(k).begin());i!=g._back.found(k).end();++i) {
+      reaching.push_back(i->second);
     }
+    unsigned int lb(g._windows[k].first);
+    unsigned int ub(g._windows[k].second);
+    poto1_oto_sort(reaching,lb,ub,n2i,g._reachingkeys,g._keybuf);
+    poto1_oto_sort(reachable,lb,ub,n2i,g._reachablekeys,g._keybuf);
+    poto1_oto_reorder<T,N2I>(g._reachablekeys,g._reachingkeys,n2i,g);
+#ifdef POTO1_GENERATE_STATS
+    ++poto1_ninvalid;
+    poto1_dxy += reaching.size() + reachable.size();
+    poto1_ARxy += (g._windows[k].second - g._windows[k].first + 1);
+#endif
+  }
+  g._windows.clear();
+  g._lanepos.clear();
+  g._inserted.clear();
+}
+
+template<class T, class N2I>
+void poto1_oto_push(typename T::vertex_descriptor t, 
+		    typename T::vertex_descriptor h, 
+		    typename boost::property_map<T, N2I>::type n2i, 
+		    poto1_online_topological_order<T,N2I> &g) {
+  unsigned int hn2i(n2i[h]);
+  unsigned int tn2i(n2i[t]);
+
+  // does this edge touch a region already collected?
+  for(unsigned int k=0;k!=g._windows.size();++k) {
+    unsigned int lb(g._windows[k].first);
+    unsigned int ub(g._windows[k].second);
+    if((hn2i >= lb && hn2i <= ub) || (tn2i >= lb && tn2i <= ub) ||
+       (hn2i < tn2i && hn2i <= ub && lb <= tn2i)) {
+      poto1_oto_flush(n2i,g);
+      // the order has changed
+      hn2i = n2i[h];
+      tn2i = n2i[t];
+      break;
+    }
+  }
+
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(t),
+	       static_cast<typename T::vertex_descriptor>(h),
+	       static_cast<T&>(g));
+  if(!r.second) { return; }
+
+  if(hn2i < tn2i) {
+    if(g._windows.empty()) { g._fwd.reset(g,n2i); }
+    unsigned int k(g._fwd.add_lane());
+    g._fwd.add_root(k,h,tn2i);
+    g._windows.push_back(std::make_pair(hn2i,tn2i));
+    g._lanepos.push_back(g._inserted.size());
+  }
+  if(!g._windows.empty()) {
+    g._inserted.push_back(r.first);
   }
+  if(g._fwd.full()) { poto1_oto_flush(n2i,g); }
 }
 
 template<class InputIter, class T, class N2I>
 void add_edges(InputIter b, InputIter e, 
 	       poto1_online_topological_order<T,N2I> &g) {
-  for(;b!=e;++b) {
-    add_edge(b->first,b->second,g);
+  if(g.lanes() <= 1) {
+    for(;b!=e;++b) {
+      add_edge(b->first,b->second,g);
+    }
+  } else {
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),g);
+    for(;b!=e;++b) {
+      poto1_oto_push<T,N2I>(b->first,b->second,n2i,g);
+    }
+    poto1_oto_flush<T,N2I>(n2i,g);
   }
 }
 
@@ -202,8 +594,8 @@ public:
   friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor, 
 								  typename self::vertex_descriptor, 
 								  self &);
-  friend void poto1_oto_reorder<T,N2I>(std::vector<unsigned int> &,
-					  std::vector<unsigned int> &,
+  friend void poto1_oto_reorder<T,N2I>(std::vector<boost::uint64_t> const &,
+					  std::vector<boost::uint64_t> const &,
 					  typename boost::property_map<T, N2I>::type n2i, 
 					  poto1_online_topological_order<T,N2I> &g);
 
@@ -211,18 +603,90 @@ public:
 				       typename self::vertex_descriptor ub,
 				       std::vector<unsigned int> &reachable,
 				       typename boost::property_map<T, N2I>::type n2i,		 
-				       self &g);
+				       self &g,
+				       std::vector<typename T::vertex_descriptor> *cycle);
   
   friend void poto1_oto_back_dfs<T,N2I>(typename self::vertex_descriptor n, 
 					typename self::vertex_descriptor lb,
 					std::vector<unsigned int> &reaching,
 					typename boost::property_map<T, N2I>::type n2i,		 
 					self &g);
+
+  friend void poto1_oto_both<T,N2I>(void *arg, unsigned int id);
+
+  friend bool poto1_oto_resort<T,N2I>(typename boost::property_map<T, N2I>::type n2i,
+				      self &g);
+
+  friend bool poto1_oto_insert<T,N2I>(typename self::vertex_descriptor t, 
+				      typename self::vertex_descriptor h,
+				      self &g,
+				      std::vector<typename T::vertex_descriptor> *witness);
+
+  friend void poto1_oto_flush<T,N2I>(typename boost::property_map<T, N2I>::type n2i,
+				     self &g);
+
+  friend void poto1_oto_push<T,N2I>(typename self::vertex_descriptor t, 
+				    typename self::vertex_descriptor h,
+				    typename boost::property_map<T, N2I>::type n2i,
+				    self &g);
 private:
-  std::vector<bool> _visited; // useful and not too expensive.
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+
+  std::vector<typename T::vertex_descriptor> _i2n;
+  visit_marks _visited;
+  visit_marks _backvisited;
+  par_bounded_search<T,N2iMap> _par;
+  // state for running the two searches concurrently
+  bool _concurrent;
+  unsigned int _cthreshold;
+  oto_lazy_pool _cpool;
+  int _cancel; // set by the forward search, read with __atomic
+  unsigned int _fwdwork;
+  unsigned int _backvisits;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<unsigned int> _reaching;
+  std::vector<unsigned int> _reachable;
+  std::vector<boost::uint64_t> _reachingkeys;
+  std::vector<boost::uint64_t> _reachablekeys;
+  std::vector<boost::uint64_t> _keybuf;
+  std::vector<dfs_frame<typename T::vertex_descriptor,
+			typename T::out_edge_iterator> > _fwdstack;
+  std::vector<dfs_frame<typename T::vertex_descriptor,
+			typename T::in_edge_iterator> > _backstack;
+  // state for interleaving the searches of a batch
+  interleaved_search<T,N2iMap,isearch_forward<T> > _fwd;
+  interleaved_search<T,N2iMap,isearch_backward<T> > _back;
+  std::vector<std::pair<unsigned int, unsigned int> > _windows;
+  std::vector<unsigned int> _lanepos; // lane's edge in _inserted
+  std::vector<typename T::edge_descriptor> _inserted;
+  // state for falling back to an offline sort
+  work_budget _budget;
+  std::vector<typename T::vertex_descriptor> _order;
+  visit_marks _sortmarks;
+  visit_marks _done;
+  std::vector<dfs_frame<typename T::vertex_descriptor,
+			typename T::out_edge_iterator> > _sortstack;
 public:
-  poto1_online_topological_order(T const &g, unsigned int acc = 1) 
-    : T(g), _visited(num_vertices(g),false) {
+  poto1_online_topological_order(T const &g, unsigned int acc = 1,
+				 unsigned int nthreads = 1,
+				 unsigned int threshold = PAR_SORT_DEFAULT_THRESHOLD) 
+    : T(g), _i2n(num_vertices(g)),
+      _visited(num_vertices(g)), _backvisited(num_vertices(g)),
+      _concurrent(false), _cthreshold(POTO1_CONCURRENT_THRESHOLD),
+      _cpool(2), _cancel(0), _fwdwork(0), _backvisits(0), _fwd(1), _back(1) {
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),*this);
+
+    if(nthreads > 1) {
+      // _i2n is already full size, so the
+      // sort can write the order straight in.
+      par_topological_sort<T> sorter(nthreads,threshold);
+      if(!sorter.sort(*this,_i2n,n2i)) {
+	throw std::runtime_error("loop detected");
+      }
+      return;
+    }
     
     // use the topological sort function to
     // order the vertices correctly ...
@@ -230,28 +694,71 @@ public:
     tmp.reserve(num_vertices(g));
     topological_sort(g,std::back_inserter(tmp));
     // finally, setup the n2i map correctly
-    typedef typename boost::property_map<T, N2I>::type N2iMap;
-    N2iMap n2i = get(N2I(),*this);
-    
     unsigned int index(0);
     for(std::vector<unsigned int>::reverse_iterator i(tmp.rbegin());i!=tmp.rend();
 	++i,++index) {
       n2i[*i]=index;
+      _i2n[index]=*i;
     }    
   }
 
   poto1_online_topological_order(typename T::vertices_size_type n,
 			       unsigned int acc = 1) 
-    : T(n), _visited(n, false) {
+    : T(n), _i2n(n), _visited(n), _backvisited(n),
+      _concurrent(false), _cthreshold(POTO1_CONCURRENT_THRESHOLD),
+      _cpool(2), _cancel(0), _fwdwork(0), _backvisits(0), _fwd(1), _back(1) {
     typedef typename boost::property_map<T, N2I>::type N2iMap;
     N2iMap n2i = get(N2I(),*this);
     
     unsigned int counter(0);
     typename T::vertex_iterator i,iend;
     for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      _i2n[counter]=*i;
       n2i[*i]=counter++;
     }
   }
+
+  typedef typename std::vector<typename T::vertex_descriptor>::const_iterator order_iterator;
+
+  // the vertices in topological order
+  std::pair<order_iterator,order_iterator> order(void) const {
+    return std::make_pair(_i2n.begin(),_i2n.end());
+  }
+
+  // the vertex at position index in the order
+  typename T::vertex_descriptor at(unsigned int index) const {
+    return _i2n[index];
+  }
+
+  // use nthreads threads for forward searches whose
+  // frontier grows beyond threshold nodes.
+  void set_parallel(unsigned int nthreads,
+		    unsigned int threshold = PAR_DEFAULT_THRESHOLD) {
+    _par.configure(nthreads,threshold);
+  }
+
+  // run the forward and backward searches on two threads
+  // when the affected region is larger than threshold.
+  void set_concurrent(bool on,
+		      unsigned int threshold = POTO1_CONCURRENT_THRESHOLD) {
+    _concurrent = on;
+    _cthreshold = threshold;
+  }
+
+  // interleave up to nlanes searches when
+  // inserting a batch of edges.
+  void set_lanes(unsigned int nlanes) {
+    _fwd.set_capacity(nlanes);
+    _back.set_capacity(nlanes);
+  }
+
+  unsigned int lanes(void) const { return _fwd.capacity(); }
+
+  // abandon any search costing more than factor times an
+  // offline sort, and sort offline instead (zero turns off).
+  void set_budget(double factor) {
+    _budget.configure(factor);
+  }
 };
 
 #endif
@@ -5,6 +5,12 @@
 // to its suitability for any purpose.
 //
 // Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// A batch version of POTO1.  The invalidating edges of a batch are
+// sorted by their tails, and those whose affected regions overlap
+// are grouped together so that each group needs only one shift.
 
 #ifndef POTO2_ONLINE_TOPOLOGICAL_ORDER_HPP
 #define POTO2_ONLINE_TOPOLOGICAL_ORDER_HPP
@@ -19,7 +25,12 @@
 #include <map>
 
 #include "oto_tags.hpp"
+#include "oto_status.hpp"
 #include "myless.hpp"
+#include "visit_marks.hpp"
+#include "interleaved_search.hpp"
+#include "parallel_topological_sort.hpp"
+#include "dfs_frame.hpp"
 
 #if __GNUC__ >= 3
 #include <ext/functional>
@@ -34,151 +45,373 @@
 #define IDENTITY std::identity
 #endif
 
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef POTO2_GENERATE_STATS
+extern unsigned int poto2_ninvalid;
+extern unsigned int poto2_ddxy;
+extern unsigned int algo_count;
+#endif
+
 #define EDGE_T std::pair<typename T::vertex_descriptor,typename T::vertex_descriptor>
 #define WORKLIST_T std::set<EDGE_T,my_less<EDGE_T, SELECT2ND<EDGE_T> > >
 
 template<class T, class N2I, class I2NMAP>
 class poto2_online_topological_order;
 
+// Shift the nodes of one group (given in [beg,end)) up the order.
+// Each node is paired with the index of the tail it must be placed
+// after, and the nodes are visited in reverse so that these
+// indices are increasing.
+
 template<class T, class N2I, class I2NMAP>
-void shift(unsigned int index, std::vector<EDGE_T> &reachables,
+void shift(unsigned int index, 
+	   typename std::vector<EDGE_T>::const_iterator beg,
+	   typename std::vector<EDGE_T>::const_iterator end,
 	   poto2_online_topological_order<T,N2I,I2NMAP> &g) {
   
   typedef typename T::vertex_descriptor vd_t;
   typedef typename boost::property_map<T, N2I>::type N2iMap;
+  typedef typename std::vector<EDGE_T>::const_iterator iterator;
   N2iMap n2i = get(N2I(),g);
 
   // now, perform the shift.
 
-  typename std::vector<EDGE_T>::reverse_iterator i(reachables.rbegin());
+  iterator i(end);
   unsigned int shift(0);
-  while(i != reachables.rend()) {    
+  while(i != beg) {    
     assert(index < g._i2n.size());
     unsigned int w(g._i2n[index]);
+#ifdef POTO2_GENERATE_STATS
+    ++algo_count;
+#endif
 
-    if(g._visited[w]) {
+    if(g._visited.marked(w)) {
       ++shift;
-      // reset the visited relation.
-      g._visited[w]=false;
     } else {
       g._i2n[index-shift]=w;
       n2i[w]=index-shift;	
     }
     // check for an end, like.
 
-    while(i != reachables.rend() && i->first == index) {
+    while(i != beg && (i-1)->first == index) {
       // ok, we're at an end point
       // so allocate now.
+      --i;
       --shift;
       g._i2n[index-shift]=i->second;
       n2i[i->second]=index-shift;	      
-      ++i;
+#ifdef POTO2_GENERATE_STATS
+      ++algo_count;
+#endif
     }
 
     ++index;
   }
 }
 
+// Returns true if a cycle is found.  As well as reaching the tail
+// of the edge, this happens if an edge leads back to a node on the
+// stack, since a cycle made from several edges of the batch need
+// not pass through the tail of the edge whose search finds it.
+
 template<class T, class N2I, class I2NMAP>
-void find_reachables(unsigned int n, unsigned int ub,
+bool find_reachables(unsigned int n, unsigned int ub,
 		     std::vector<EDGE_T> &reachables,
 		     poto2_online_topological_order<T,N2I,I2NMAP> &g) {
   // some useful typedefs
   
   typedef typename T::out_edge_iterator out_iterator;
   typedef typename boost::property_map<T, N2I>::type N2iMap;
+  typedef dfs_frame<typename T::vertex_descriptor,out_iterator> frame;
 
   // could undoubtedly optimise this get away. It
   // might be expensive for all I know ...
 
   N2iMap n2i = get(N2I(),g);
+
+  // the stack is kept between calls
+  std::vector<frame> &stack(g._stack);
+  stack.clear();
   
-  g._visited[n]=true;
-  
-  out_iterator i,iend;
-  for(tie(i,iend) = out_edges(n,g); i!=iend;++i) {
-    unsigned int w(target(*i,g));
+  g._visited.mark(n);
+  g._onstack.mark(n);
+  stack.push_back(frame(n,out_edges(n,g)));
+#ifdef POTO2_GENERATE_STATS
+  ++poto2_ddxy;
+  ++algo_count;
+#endif
+
+  while(!stack.empty()) {
+    frame &f(stack.back());
+    if(f.i == f.iend) {
+      // all successors done, so add in post-order
+      reachables.push_back(EDGE_T(ub,f.v));
+      g._onstack.unmark(f.v);
+      stack.pop_back();
+      continue;
+    }
+    unsigned int w(target(*f.i,g));
     unsigned int wn2i(n2i[w]);
-    if(wn2i == ub) {
+    ++f.i;
+#ifdef POTO2_GENERATE_STATS
+    ++poto2_ddxy;
+    ++algo_count;
+#endif
+    if(wn2i == ub || (wn2i < ub && g._onstack.marked(w))) {
       // this is the special case
       // where a cycle has been detected
-      throw std::runtime_error("CYCLE DETECTED");
-    } else if(wn2i < ub && !g._visited[w]) {
-      find_reachables(w,ub,reachables,g);
+      return true;
+    } else if(wn2i < ub && !g._visited.marked(w)) {
+      g._visited.mark(w);
+      g._onstack.mark(w);
+      stack.push_back(frame(w,out_edges(w,g)));
+#ifdef POTO2_GENERATE_STATS
+      ++poto2_ddxy;
+      ++algo_count;
+#endif
     }
   }
-  
-  reachables.push_back(EDGE_T(ub,n));
+  return false;
 }
 
+// The back edges, sorted by their tails, fall into groups which
+// cover disjoint parts of the order.  A search from the head of
+// one group's edge cannot leave its group's part of the order, so
+// all of the searches can be done before any shifting.  Thus, if a
+// cycle is found, nothing has been moved yet.  The nodes found for
+// group k are held in _reachables, ending at _ends[k], and the
+// group begins at _lbs[k] in the order.
+
 template<class T, class N2I, class I2NMAP>
-void add_edges(typename std::vector<EDGE_T>::iterator beg, 
-	       typename std::vector<EDGE_T>::iterator end, 
-	       poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+bool poto2_oto_search(poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+  std::vector<EDGE_T> &backedges(g._backedges);
+  std::vector<unsigned int> &lbs(g._lbs);
+  unsigned int lb(g._i2n.size());
+  g._visited.clear();
+  g._onstack.clear();
+
+  for(typename std::vector<EDGE_T>::reverse_iterator i(backedges.rbegin());
+      i!=backedges.rend();++i) {
+    if(lbs.empty() || i->first < lb) {
+      // start a new group
+      if(!lbs.empty()) { g._ends.push_back(g._reachables.size()); }
+      lbs.push_back(lb);
+    }
+    if(!g._visited.marked(i->second) &&
+       find_reachables<T,N2I,I2NMAP>(i->second,i->first,g._reachables,g)) {
+      return true;
+    }
+    lb = std::min(lb,n2i[i->second]);
+    lbs.back() = lb;
+  }
+  g._ends.push_back(g._reachables.size());
+  return false;
+}
+
+// When interleaving is turned on, the searches of each group of
+// back edges are run in their own lane instead.  Within a group,
+// the searches are done one after the other in the usual order.
+
+template<class T, class N2I, class I2NMAP>
+bool poto2_oto_gather(poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+  g._isearch.run();
+
+  for(unsigned int k=0;k!=g._isearch.size();++k) {
+#ifdef POTO2_GENERATE_STATS
+    poto2_ddxy += g._isearch.nvisits(k);
+    algo_count += g._isearch.nvisits(k);
+#endif
+    if(g._isearch.stopped_early(k)) { return true; }
+    typename std::vector<std::pair<unsigned int, typename T::vertex_descriptor> >::const_iterator i;
+    for(i=g._isearch.found(k).begin();i!=g._isearch.found(k).end();++i) {
+      g._reachables.push_back(EDGE_T(i->first,i->second));
+    }
+    g._ends.push_back(g._reachables.size());
+  }
+  g._isearch.reset(g,n2i);
+  return false;
+}
+
+template<class T, class N2I, class I2NMAP>
+bool poto2_oto_search_lanes(poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+  std::vector<EDGE_T> &backedges(g._backedges);
+  std::vector<unsigned int> &lbs(g._lbs);
+  unsigned int lb(g._i2n.size());
+  unsigned int k(0);
+  g._isearch.reset(g,n2i);
+
+  for(typename std::vector<EDGE_T>::reverse_iterator i(backedges.rbegin());
+      i!=backedges.rend();++i) {
+    if(lbs.empty() || i->first < lb) {
+      if(g._isearch.full() && poto2_oto_gather(g)) { return true; }
+      k = g._isearch.add_lane();
+      lbs.push_back(lb);
+    }
+    g._isearch.add_root(k,i->second,i->first);
+    lb = std::min(lb,n2i[i->second]);
+    lbs.back() = lb;
+  }
+  if(poto2_oto_gather(g)) { return true; }
 
-  std::vector<EDGE_T> backedges;
+  // the shift needs the nodes of every group marked
+  g._visited.clear();
+  for(typename std::vector<EDGE_T>::iterator i(g._reachables.begin());
+      i!=g._reachables.end();++i) {
+    g._visited.mark(i->second);
+  }
+  return false;
+}
+
+// A batch is applied all or nothing: if it would introduce a
+// cycle, the edges inserted so far are taken out again and false
+// is returned, leaving the graph and order as they were.  The
+// edges are removed by descriptor, so that parallel copies already
+// in the graph before the batch are left alone.
+
+template<class InputIter, class T, class N2I, class I2NMAP>
+bool poto2_oto_insert(InputIter beg, InputIter end, 
+		      poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  std::vector<EDGE_T> &backedges(g._backedges);
+  std::vector<typename T::edge_descriptor> &inserted(g._inserted);
+  backedges.clear();
+  inserted.clear();
   for(;beg!=end;++beg) {
     std::pair<typename T::edge_descriptor, bool> r;
-    EDGE_T e(*beg);
+    EDGE_T e(beg->first,beg->second);
     r = add_edge(static_cast<typename T::vertex_descriptor>(e.first),
 		 static_cast<typename T::vertex_descriptor>(e.second),
 		 static_cast<T&>(g));
-    
-    typedef typename boost::property_map<T, N2I>::type N2iMap;
-    N2iMap n2i = get(N2I(),g);
+    if(!r.second) { continue; }
+    inserted.push_back(r.first);
     
     unsigned int hn2i(n2i[e.second]);
     unsigned int tn2i(n2i[e.first]);
     
-    if(r.second && hn2i < tn2i) {
-      backedges.push_back(EDGE_T(n2i[e.first],e.second));
+    if(hn2i < tn2i) {
+      backedges.push_back(EDGE_T(tn2i,e.second));
     }
   }
 
-  if(!backedges.empty()) {
-    typedef typename boost::property_map<T, N2I>::type N2iMap;
-    N2iMap n2i = get(N2I(),g);
-    //    my_less<EDGE_T, SELECT1ST<EDGE_T> > comp;
-    // sort back edges into increasing order by their tail
-    std::sort(backedges.begin(),backedges.end(),my_less<EDGE_T, SELECT1ST<EDGE_T> >());
-    std::vector<EDGE_T> reachables;
-    unsigned int lb(g._i2n.size());
-
-    // now, identify reachables
-    for(typename std::vector<EDGE_T>::reverse_iterator i(backedges.rbegin());
-	i!=backedges.rend();++i) {
-      if(i->first < lb && !reachables.empty()) { 
-	
-	shift(lb,reachables,g);
-	reachables.clear();
-      }
-      if(!g._visited[i->second]) {
-	find_reachables<T,N2I,I2NMAP>(i->second,i->first,reachables,g);
-      }
-      lb = std::min(lb,n2i[i->second]);
-    }
+  if(backedges.empty()) { return true; }
+
+  // sort back edges into increasing order by their tail
+  std::sort(backedges.begin(),backedges.end(),my_less<EDGE_T, SELECT1ST<EDGE_T> >());
+  g._reachables.clear();
+  g._lbs.clear();
+  g._ends.clear();
+
+  bool cycle;
+  if(g._isearch.capacity() > 1) {
+    // one lane per group
+    cycle = poto2_oto_search_lanes(g);
+  } else {
+    cycle = poto2_oto_search(g);
+  }
 
-    if(!reachables.empty()) { 	
-      shift(lb,reachables,g);
+  if(cycle) {
+    for(typename std::vector<typename T::edge_descriptor>::iterator i(inserted.begin());
+	i!=inserted.end();++i) {
+      remove_edge(*i,static_cast<T&>(g));
     }
-  }  
+    return false;
+  }
+
+#ifdef POTO2_GENERATE_STATS
+  poto2_ninvalid += backedges.size();
+#endif
+  typename std::vector<EDGE_T>::const_iterator b(g._reachables.begin());
+  for(unsigned int k=0;k!=g._lbs.size();++k) {
+    typename std::vector<EDGE_T>::const_iterator e(g._reachables.begin() + g._ends[k]);
+    shift(g._lbs[k],b,e,g);
+    b = e;
+  }
+  return true;
+}
+
+template<class InputIter, class T, class N2I, class I2NMAP>
+void add_edges(InputIter beg, InputIter end, 
+	       poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+  if(!poto2_oto_insert(beg,end,g)) {
+    throw std::runtime_error("CYCLE DETECTED");
+  }
+}
+
+// This is simply a batch of one edge.
+
+template<class T, class N2I, class I2NMAP>
+oto_status
+try_add_edge(typename poto2_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor t, 
+	     typename poto2_online_topological_order<T,N2I,I2NMAP>::vertex_descriptor h, 
+	     poto2_online_topological_order<T,N2I,I2NMAP> &g) {
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  EDGE_T e(t,h);
+  return poto2_oto_insert(&e,&e+1,g) ? OTO_INSERTED : OTO_CYCLE;
 }
 
 template<class T, class N2I = n2i_t, class I2NMAP = std::vector<typename T::vertex_descriptor> >
 class poto2_online_topological_order : public T {
 public:
   typedef poto2_online_topological_order<T,N2I,I2NMAP> self;
-  friend void add_edges<>(typename std::vector<EDGE_T>::iterator, typename std::vector<EDGE_T>::iterator, 
-			self &);
-  friend void find_reachables<>(unsigned int, unsigned int, std::vector<EDGE_T> &,
+  template<class InputIter, class T2, class N2I2, class I2NMAP2>
+  friend bool poto2_oto_insert(InputIter, InputIter, 
+			       poto2_online_topological_order<T2,N2I2,I2NMAP2> &);
+  friend bool find_reachables<>(unsigned int, unsigned int, std::vector<EDGE_T> &,
 				self &);
-  friend void shift<>(unsigned int, std::vector<EDGE_T> &, self &);
+  friend void shift<>(unsigned int, 
+		      typename std::vector<EDGE_T>::const_iterator,
+		      typename std::vector<EDGE_T>::const_iterator,
+		      self &);
+  friend bool poto2_oto_search<>(self &);
+  friend bool poto2_oto_gather<>(self &);
+  friend bool poto2_oto_search_lanes<>(self &);
 private:
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+
   I2NMAP _i2n;
-  std::vector<bool> _visited; // useful and not too expensive.
+  visit_marks _visited;
+  visit_marks _onstack;
+  // scratch space, kept between batches
+  // so that they don't need to allocate.
+  std::vector<EDGE_T> _backedges;
+  std::vector<typename T::edge_descriptor> _inserted;
+  std::vector<EDGE_T> _reachables;
+  std::vector<unsigned int> _ends; // end of each group in _reachables
+  std::vector<dfs_frame<typename T::vertex_descriptor,
+			typename T::out_edge_iterator> > _stack;
+  // state for interleaving the searches of a batch
+  interleaved_search<T,N2iMap,isearch_forward<T> > _isearch;
+  std::vector<unsigned int> _lbs; // lower bound of each group
 public:
-  poto2_online_topological_order(T const &g, unsigned int acc = 1) 
-    : T(g), _visited(num_vertices(g),false)  {
+  poto2_online_topological_order(T const &g, unsigned int acc = 1,
+				 unsigned int nthreads = 1,
+				 unsigned int threshold = PAR_SORT_DEFAULT_THRESHOLD) 
+    : T(g), _visited(num_vertices(g)), _onstack(num_vertices(g)), 
+      _isearch(1)  {
+    _isearch.set_cycle_check(true);
+    typedef typename boost::property_map<T, N2I>::type N2iMap;
+    N2iMap n2i = get(N2I(),*this);
+
+    if(nthreads > 1) {
+      // as for MNR, but _i2n must first
+      // be given room for every node.
+      par_topological_sort<T> sorter(nthreads,threshold);
+      _i2n.resize(num_vertices(g));
+      if(!sorter.sort(*this,_i2n,n2i)) {
+	throw std::runtime_error("loop detected");
+      }
+      return;
+    }
     
     // use the topological sort function to
     // order the vertices correctly ...
@@ -187,9 +420,6 @@ public:
     // now reverse them
     reverse(_i2n.begin(),_i2n.end());
     // finally, setup the n2i map correctly
-    typedef typename boost::property_map<T, N2I>::type N2iMap;
-    N2iMap n2i = get(N2I(),*this);
-    
     for(unsigned int i=0;i!=_i2n.size();++i) {
       n2i[_i2n[i]]=i;
     }    
@@ -197,7 +427,8 @@ public:
 
   poto2_online_topological_order(typename T::vertices_size_type n,
 			       unsigned int acc = 1) 
-    : T(n), _i2n(n), _visited(n,false) {
+    : T(n), _i2n(n), _visited(n), _onstack(n), _isearch(1) {
+    _isearch.set_cycle_check(true);
     typedef typename boost::property_map<T, N2I>::type N2iMap;
     N2iMap n2i = get(N2I(),*this);
     
@@ -208,6 +439,12 @@ public:
       n2i[*i]=counter++;
     }
   }
+
+  // interleave the searches of up to
+  // nlanes groups of back edges.
+  void set_lanes(unsigned int nlanes) {
+    _isearch.set_capacity(nlanes);
+  }
 };
 
 #undef WORKLIST_T
@@ -0,0 +1,437 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// This is POTO1, but an edge which closes a cycle is allowed.  The
+// nodes on the cycle are collapsed into one, and it is the order of
+// the collapsed graph (the condensation) which is kept.  This is
+// what is needed when solving the constraint graphs of pointer
+// analysis, as described in:
+//
+// [1] David J. Pearce. Some directed graph algorithms and their
+//     application to pointer analysis. Ph.D. Thesis, Imperial College
+//     of Science, Technology and Medicine, University of London,
+//     February 2005.
+//
+// The components are kept with a union-find, and each representative
+// has the edges of all its members spliced together.  So, the
+// searches work on representatives alone, and the graph itself is
+// never changed.  All members of a component share the index of
+// their representative.
+//
+// When t->h is added with n2i[h] < n2i[t], the forward search from h
+// and the backward search from t are always done in full.  If the
+// forward search reaches t, then the nodes found by both searches
+// are exactly those on a cycle through t->h.  These become one
+// component, placed after the other backward nodes and before the
+// other forward nodes.  As for POTO1, the backward nodes take the
+// lowest indices of those freed up, and the forward nodes the
+// highest, so that backward nodes only move down and forward nodes
+// only move up.  The component takes the next index after the
+// backward nodes, and the rest are simply left unused.
+//
+// Removing an edge between two components just takes it out of
+// their lists.  Removing one from inside a component may leave it
+// no longer strongly connected.  The order is still valid, though,
+// so the component is only split up again by compact(), which works
+// everything out afresh.  By default, this is called once as many
+// edges have gone from inside components as there are nodes.  This
+// can be set to any multiple of the nodes, or turned off.
+
+#ifndef SCC_ONLINE_TOPOLOGICAL_ORDER_HPP
+#define SCC_ONLINE_TOPOLOGICAL_ORDER_HPP
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <boost/property_map.hpp>
+#include <boost/graph/strong_components.hpp>
+#include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "visit_marks.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef SCC_GENERATE_STATS
+extern unsigned int scc_ninvalid;
+extern unsigned int scc_ddxy;
+extern unsigned int scc_ncollapsed;
+extern unsigned int scc_ncompacts;
+#endif
+
+template<class T, class N2I>
+class scc_online_topological_order;
+
+template<class T, class N2I>
+std::pair<typename T::edge_descriptor, bool>
+add_edge(typename scc_online_topological_order<T,N2I>::vertex_descriptor t,
+	 typename scc_online_topological_order<T,N2I>::vertex_descriptor h,
+	 scc_online_topological_order<T,N2I> &g) {
+  std::pair<typename T::edge_descriptor, bool> r;
+  r = add_edge(static_cast<typename T::vertex_descriptor>(t),
+	       static_cast<typename T::vertex_descriptor>(h),
+	       static_cast<T&>(g));
+
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  if(!r.second) { return r; }
+  typename T::vertex_descriptor rt(g.component(t));
+  typename T::vertex_descriptor rh(g.component(h));
+  if(rt == rh) { return r; }
+  g._out[rt].push_back(h);
+  g._in[rh].push_back(t);
+
+  if(n2i[rh] < n2i[rt]) {
+    g.reorder(rt,rh);
+#ifdef SCC_GENERATE_STATS
+    ++scc_ninvalid;
+#endif
+  }
+  return r;
+}
+
+// Cycles are collapsed rather than rejected, so
+// an edge is only ever turned away if it is there.
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename scc_online_topological_order<T,N2I>::vertex_descriptor t,
+	     typename scc_online_topological_order<T,N2I>::vertex_descriptor h,
+	     scc_online_topological_order<T,N2I> &g) {
+  return add_edge(t,h,g).second ? OTO_INSERTED : OTO_DUPLICATE;
+}
+
+template<class T, class N2I>
+void remove_edge(typename scc_online_topological_order<T,N2I>::vertex_descriptor t,
+		 typename scc_online_topological_order<T,N2I>::vertex_descriptor h,
+		 scc_online_topological_order<T,N2I> &g) {
+  typedef typename T::vertex_descriptor vd_t;
+  // the lists have an entry for each copy of t->h
+  unsigned int ncopies(0);
+  typename T::out_edge_iterator i,iend;
+  for(tie(i,iend) = out_edges(t,g);i!=iend;++i) {
+    if(target(*i,g) == h) { ++ncopies; }
+  }
+  remove_edge(static_cast<vd_t>(t),static_cast<vd_t>(h),static_cast<T&>(g));
+  if(ncopies == 0) { return; }
+
+  vd_t rt(g.component(t));
+  vd_t rh(g.component(h));
+  if(rt != rh) {
+    g.unlist(g._out[rt],h,ncopies);
+    g.unlist(g._in[rh],t,ncopies);
+  } else if(++g._nstale, g._cfactor > 0 &&
+	    g._nstale >= g._cfactor * num_vertices(g)) {
+    g.compact();
+#ifdef SCC_GENERATE_STATS
+    ++scc_ncompacts;
+#endif
+  }
+}
+
+template<class InputIter, class T, class N2I>
+void add_edges(InputIter b, InputIter e,
+	       scc_online_topological_order<T,N2I> &g) {
+  for(;b!=e;++b) {
+    add_edge(b->first,b->second,g);
+  }
+}
+
+template<class T, class N2I = n2i_t>
+class scc_online_topological_order : public T {
+public:
+  typedef scc_online_topological_order<T,N2I> self;
+  friend std::pair<typename T::edge_descriptor, bool> add_edge<T>(typename self::vertex_descriptor,
+								  typename self::vertex_descriptor,
+								  self &);
+  friend void remove_edge<T>(typename self::vertex_descriptor,
+			     typename self::vertex_descriptor,
+			     self &);
+private:
+  typedef typename T::vertex_descriptor vd_t;
+  typedef typename boost::property_map<T, N2I>::type n2i_map;
+
+  // the union-find
+  std::vector<vd_t> _parent;
+  std::vector<unsigned int> _rank;
+  // the members of each component, as a ring
+  std::vector<vd_t> _next;
+  // the edges of each representative
+  std::vector<std::vector<vd_t> > _out;
+  std::vector<std::vector<vd_t> > _in;
+  // edges removed from inside components since they were
+  // last worked out, which may have left them disconnected
+  unsigned int _nstale;
+  double _cfactor; // stale edges per node before compacting, or zero
+  visit_marks _fmarks;
+  visit_marks _bmarks;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _stack;
+  std::vector<vd_t> _fnodes;
+  std::vector<vd_t> _bnodes;
+  std::vector<vd_t> _cycle;
+  std::vector<unsigned int> _pool;
+public:
+  scc_online_topological_order(T const &g, unsigned int acc = 1)
+    : T(g), _nstale(0), _cfactor(1), _fmarks(num_vertices(g)), _bmarks(num_vertices(g)) {
+    // the graph may have cycles of its own, so its
+    // components are collapsed before it is ordered.
+    compact();
+  }
+
+  scc_online_topological_order(typename T::vertices_size_type n,
+			       unsigned int acc = 1)
+    : T(n), _nstale(0), _cfactor(1), _fmarks(n), _bmarks(n) {
+    init();
+    n2i_map n2i = get(N2I(),*this);
+
+    unsigned int counter(0);
+    typename T::vertex_iterator i,iend;
+    for(tie(i,iend) = vertices(*this);i!=iend;++i) {
+      n2i[*i]=counter++;
+    }
+  }
+
+  // the representative of v's component
+  vd_t component(vd_t v) {
+    while(_parent[v] != v) {
+      _parent[v] = _parent[_parent[v]];
+      v = _parent[v];
+    }
+    return v;
+  }
+
+  // the next member of v's component, which
+  // comes back round to v after them all.
+  vd_t next_member(vd_t v) const { return _next[v]; }
+
+  // compact once factor edges per node have gone
+  // from inside components (zero turns off).
+  void set_compact(double factor) { _cfactor = factor; }
+
+  // edges removed from inside components since compact()
+  unsigned int nstale(void) const { return _nstale; }
+
+  // Work out the components and the order afresh, in O(V+E)
+  // time.  This splits up any component which is no longer
+  // strongly connected, and leaves no index unused.
+
+  void compact(void) {
+    n2i_map n2i = get(N2I(),*this);
+    unsigned int n(num_vertices(*this));
+    std::vector<unsigned int> comp(n);
+    unsigned int ncomps(strong_components(static_cast<T const &>(*this),
+					  make_iterator_property_map(comp.begin(),
+								     get(boost::vertex_index,*this))));
+    init();
+    typename T::edge_iterator i,iend;
+    for(tie(i,iend) = edges(*this);i!=iend;++i) {
+      _out[source(*i,*this)].push_back(target(*i,*this));
+      _in[target(*i,*this)].push_back(source(*i,*this));
+    }
+    // group the nodes by component, and collapse each group
+    std::vector<std::pair<unsigned int, vd_t> > tmp;
+    tmp.reserve(n);
+    for(unsigned int v=0;v!=n;++v) {
+      tmp.push_back(std::make_pair(comp[v],(vd_t) v));
+    }
+    std::sort(tmp.begin(),tmp.end());
+    std::vector<vd_t> &members(_cycle);
+    for(unsigned int j=0,k=0;j!=n;j=k) {
+      members.clear();
+      for(k=j;k!=n && tmp[k].first == tmp[j].first;++k) {
+	members.push_back(tmp[k].second);
+      }
+      if(members.size() > 1) { collapse(members); }
+    }
+    // Tarjan's algorithm numbers the components sinks first
+    for(unsigned int v=0;v!=n;++v) {
+      n2i[v] = ncomps - 1 - comp[v];
+    }
+    _nstale = 0;
+  }
+protected:
+  void reorder(vd_t rt, vd_t rh) {
+    n2i_map n2i = get(N2I(),*this);
+    unsigned int lb(n2i[rh]);
+    unsigned int ub(n2i[rt]);
+
+    bool cycle(search(rh,ub,true,_fmarks,_fnodes));
+    search(rt,lb,false,_bmarks,_bnodes);
+
+    // take out the cycle, if any.  Its nodes are in
+    // both sets, except that rt is only in the backward
+    // set and rh only in the forward set.
+    std::vector<vd_t> &cycle_nodes(_cycle);
+    cycle_nodes.clear();
+    if(cycle) {
+      split(_bnodes,_fmarks,&cycle_nodes);
+      split(_fnodes,_bmarks,NULL);
+      cycle_nodes.push_back(rh);
+    }
+
+    // all of these give up their indices
+    std::vector<unsigned int> &pool(_pool);
+    pool.clear();
+    for(unsigned int i=0;i!=_bnodes.size();++i) { pool.push_back(n2i[_bnodes[i]]); }
+    for(unsigned int i=0;i!=cycle_nodes.size();++i) { pool.push_back(n2i[cycle_nodes[i]]); }
+    for(unsigned int i=0;i!=_fnodes.size();++i) { pool.push_back(n2i[_fnodes[i]]); }
+    std::sort(pool.begin(),pool.end());
+
+    n2i_comp comp(n2i);
+    std::sort(_bnodes.begin(),_bnodes.end(),comp);
+    std::sort(_fnodes.begin(),_fnodes.end(),comp);
+    for(unsigned int i=0;i!=_bnodes.size();++i) {
+      place(_bnodes[i],pool[i]);
+    }
+    if(cycle) {
+      place(collapse(cycle_nodes),pool[_bnodes.size()]);
+#ifdef SCC_GENERATE_STATS
+      scc_ncollapsed += cycle_nodes.size() - 1;
+#endif
+    }
+    unsigned int k(pool.size() - _fnodes.size());
+    for(unsigned int i=0;i!=_fnodes.size();++i,++k) {
+      place(_fnodes[i],pool[k]);
+    }
+  }
+private:
+  void init(void) {
+    unsigned int n(num_vertices(*this));
+    _parent.resize(n);
+    _next.resize(n);
+    _rank.assign(n,0);
+    _out.assign(n,std::vector<vd_t>());
+    _in.assign(n,std::vector<vd_t>());
+    for(unsigned int i=0;i!=n;++i) {
+      _parent[i] = i;
+      _next[i] = i;
+    }
+  }
+
+  // Mark, and collect in nodes, the representatives reachable from
+  // x (forwards or backwards) with index strictly between those of
+  // rh and rt.  The far end, at index limit, is marked but not gone
+  // past.  Returns true if the far end is reached.
+
+  bool search(vd_t x, unsigned int limit, bool forward,
+	      visit_marks &marks, std::vector<vd_t> &nodes) {
+    n2i_map n2i = get(N2I(),*this);
+    std::vector<vd_t> &stack(_stack);
+    bool found(false);
+    nodes.clear();
+    marks.clear();
+    marks.mark(x);
+    stack.clear();
+    stack.push_back(x);
+    while(!stack.empty()) {
+      vd_t y(stack.back());
+      stack.pop_back();
+      nodes.push_back(y);
+      std::vector<vd_t> const &adj(forward ? _out[y] : _in[y]);
+      for(unsigned int i=0;i!=adj.size();++i) {
+	vd_t w(component(adj[i]));
+#ifdef SCC_GENERATE_STATS
+	++scc_ddxy;
+#endif
+	if(marks.marked(w)) {
+	  continue;
+	} else if(n2i[w] == limit) {
+	  marks.mark(w);
+	  found = true;
+	} else if(forward ? n2i[w] < limit : n2i[w] > limit) {
+	  marks.mark(w);
+	  stack.push_back(w);
+	}
+      }
+    }
+    return found;
+  }
+
+  // remove the nodes of from which are in other,
+  // moving them into to if it is given.
+  void split(std::vector<vd_t> &from, visit_marks const &other,
+	     std::vector<vd_t> *to) {
+    unsigned int k(0);
+    for(unsigned int i=0;i!=from.size();++i) {
+      if(other.marked(from[i])) {
+	if(to != NULL) { to->push_back(from[i]); }
+      } else {
+	from[k++] = from[i];
+      }
+    }
+    from.resize(k);
+  }
+
+  // Union the components, splicing their rings and edges
+  // together, and return the new representative.
+
+  vd_t collapse(std::vector<vd_t> const &nodes) {
+    vd_t r(nodes[0]);
+    for(unsigned int i=1;i!=nodes.size();++i) {
+      vd_t x(nodes[i]);
+      if(_rank[x] > _rank[r]) { std::swap(x,r); }
+      if(_rank[x] == _rank[r]) { ++_rank[r]; }
+      _parent[x] = r;
+      std::swap(_next[x],_next[r]);
+      splice(_out[r],_out[x]);
+      splice(_in[r],_in[x]);
+    }
+    // drop the edges which are now inside
+    // the component, as they can't be needed.
+    prune(_out[r],r);
+    prune(_in[r],r);
+    return r;
+  }
+
+  void splice(std::vector<vd_t> &to, std::vector<vd_t> &from) {
+    if(from.size() > to.size()) { to.swap(from); }
+    to.insert(to.end(),from.begin(),from.end());
+    std::vector<vd_t>().swap(from);
+  }
+
+  // take n of the entries for x out of adj
+  void unlist(std::vector<vd_t> &adj, vd_t x, unsigned int n) {
+    for(unsigned int i=adj.size();i-- > 0 && n > 0;) {
+      if(adj[i] == x) {
+	adj[i] = adj.back();
+	adj.pop_back();
+	--n;
+      }
+    }
+  }
+
+  void prune(std::vector<vd_t> &adj, vd_t r) {
+    unsigned int k(0);
+    for(unsigned int i=0;i!=adj.size();++i) {
+      if(component(adj[i]) != r) { adj[k++] = adj[i]; }
+    }
+    adj.resize(k);
+  }
+
+  // give the component of representative r index c
+  void place(vd_t r, unsigned int c) {
+    n2i_map n2i = get(N2I(),*this);
+    vd_t x(r);
+    do {
+      n2i[x] = c;
+      x = _next[x];
+    } while(x != r);
+  }
+
+  struct n2i_comp {
+    n2i_map n2i;
+    n2i_comp(n2i_map m) : n2i(m) {}
+    bool operator()(vd_t a, vd_t b) const { return n2i[a] < n2i[b]; }
+  };
+};
+
+#endif
@@ -11,7 +11,8 @@
 // This is basically a very simplistic approach
 // to topological ordering the graph. It uses
 // the standard (exhaustive) topological sort
-// function.
+// function.  When given more than one thread,
+// the parallel (Kahn) sort is used instead.
 
 #ifndef SIMPLE_TOPOLOGICAL_ORDER_HPP
 #define SIMPLE_TOPOLOGICAL_ORDER_HPP
@@ -20,6 +21,11 @@
 #include <boost/property_map.hpp>
 #include <boost/graph/topological_sort.hpp>
 #include "oto_tags.hpp"
+#include "oto_status.hpp"
+#include "work_budget.hpp"
+#include "visit_marks.hpp"
+#include "dfs_frame.hpp"
+#include "parallel_topological_sort.hpp"
 
 #ifdef SOTO_GENERATE_STATS
 extern unsigned int algo_count;
@@ -34,31 +40,43 @@ void sto_dfs_visit(unsigned int n, unsigned int &count,
 		   simple_topological_order<T,N2I> &g) {
   // some useful typedefs
 
+  typedef typename T::out_edge_iterator out_iterator;
+  typedef dfs_frame<typename T::vertex_descriptor,out_iterator> frame;
+
+  // the stack is kept between calls
+  std::vector<frame> &stack(g._stack);
+  stack.clear();
+
 #ifdef SOTO_GENERATE_STATS
   ++algo_count;
 #endif
   
-  typedef typename T::out_edge_iterator out_iterator;
-
-  // could undoubtedly optimise this get away. It
-  // might be expensive for all I know ...
-  
-  g._visited[n]=true;
-  
-  out_iterator i,iend;
-  for(tie(i,iend) = out_edges(n,g); i!=iend;++i) {
+  g._visited.mark(n);
+  stack.push_back(frame(n,out_edges(n,g)));
+
+  while(!stack.empty()) {
+    frame &f(stack.back());
+    if(f.i == f.iend) {
+      // all successors done
+      n2i[f.v] = --count;
+      stack.pop_back();
+      continue;
+    }
 
 #ifdef SOTO_GENERATE_STATS
     ++algo_count;
 #endif
 
-    unsigned int w(target(*i,g));
-    if(!g._visited[w]) {
-      sto_dfs_visit(w,count,n2i,g);
+    unsigned int w(target(*f.i,g));
+    ++f.i;
+    if(!g._visited.marked(w)) {
+#ifdef SOTO_GENERATE_STATS
+      ++algo_count;
+#endif
+      g._visited.mark(w);
+      stack.push_back(frame(w,out_edges(w,g)));
     }
   }
-  
-  n2i[n] = --count;
 }
 
 template<class InputIter, class T, class N2I>
@@ -80,18 +98,70 @@ void add_edges(InputIter b, InputIter e,
     }
   }
 
-  if(flag) {
+  if(flag && g._par.active()) {
+#ifdef SOTO_GENERATE_STATS
+    // every node and edge is looked at once
+    algo_count += num_vertices(g) + num_edges(g);
+#endif
+    if(!g._par.sort(g,g._i2n,n2i)) {
+      throw std::runtime_error("loop detected");
+    }
+  } else if(flag) {
     unsigned int c(num_vertices(g));
     unsigned int count(num_vertices(g));
+    g._visited.clear();
     for(unsigned int i=0;i!=c;++i) {
-      if(!g._visited[i]) {
+      if(!g._visited.marked(i)) {
 	sto_dfs_visit(i,count,n2i,g);
       }
     }
-    fill(g._visited.begin(),g._visited.end(),false);
   }
 }
 
+// Sort the graph again, noticing any cycle.  Returns false,
+// leaving the order alone, if there is one.
+
+template<class T, class N2I>
+bool sto_resort(simple_topological_order<T,N2I> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+  unsigned int cost(num_vertices(g) + num_edges(g));
+
+  if(g._par.active()) {
+    if(!g._par.sort(g,g._i2n,n2i)) { return false; }
+  } else {
+    if(!offline_topological_sort(static_cast<T const &>(g),g._order,
+				 g._visited,g._done,g._stack,cost)) {
+      return false;
+    }
+    for(unsigned int i=0;i!=g._order.size();++i) {
+      n2i[g._order[i]] = i;
+    }
+  }
+#ifdef SOTO_GENERATE_STATS
+  algo_count += cost;
+#endif
+  return true;
+}
+
+template<class T, class N2I>
+oto_status
+try_add_edge(typename simple_topological_order<T,N2I>::vertex_descriptor t,
+	     typename simple_topological_order<T,N2I>::vertex_descriptor h,
+	     simple_topological_order<T,N2I> &g) {
+  typedef typename boost::property_map<T, N2I>::type N2iMap;
+  N2iMap n2i = get(N2I(),g);
+
+  oto_status s(oto_check(t,h,static_cast<T const &>(g)));
+  if(s != OTO_INSERTED) { return s; }
+  add_edge(t,h,static_cast<T&>(g));
+  if(n2i[h] < n2i[t] && !sto_resort(g)) {
+    remove_edge(t,h,static_cast<T&>(g));
+    return OTO_CYCLE;
+  }
+  return OTO_INSERTED;
+}
+
 template<class T, class N2I = n2i_t>
 class simple_topological_order : public T {
 public:
@@ -102,31 +172,48 @@ public:
   friend void sto_dfs_visit<>(unsigned int, unsigned int &, 
 			      typename boost::property_map<T, N2I>::type &,
 			      self &);
+  friend bool sto_resort<>(self &);
 private:  
-  std::vector<bool> _visited; // useful and not too expensive.
+  visit_marks _visited;
+  visit_marks _done;
+  std::vector<typename T::vertex_descriptor> _order;
+  std::vector<dfs_frame<typename T::vertex_descriptor,
+			typename T::out_edge_iterator> > _stack;
+  // state for the parallel sort
+  par_topological_sort<T> _par;
+  std::vector<typename T::vertex_descriptor> _i2n;
 public:
-  simple_topological_order(T const &g, unsigned int acc = 1) 
-    : T(g), _visited(num_vertices(g),false) {
+  simple_topological_order(T const &g, unsigned int acc = 1,
+			   unsigned int nthreads = 1,
+			   unsigned int threshold = PAR_SORT_DEFAULT_THRESHOLD) 
+    : T(g), _visited(num_vertices(g)), _par(nthreads,threshold),
+      _i2n(num_vertices(g)) {
     
     // use the topological sort function to
     // order the vertices correctly ...
 
     typedef typename boost::property_map<T, N2I>::type N2iMap;
     N2iMap n2i = get(N2I(),*this);
+
+    if(_par.active()) {
+      if(!_par.sort(*this,_i2n,n2i)) {
+	throw std::runtime_error("loop detected");
+      }
+      return;
+    }
     
     unsigned int count(num_vertices(g));
     for(unsigned int i=0;i!=num_vertices(g);++i) {
-      if(!_visited[i]) {
+      if(!_visited.marked(i)) {
 	sto_dfs_visit(i,count,n2i,*this);
       }
     }
     assert(count == 0);
-    fill(_visited.begin(),_visited.end(),false);
   }
 
   simple_topological_order(typename T::vertices_size_type n,
 			       unsigned int acc = 1) 
-    : T(n), _visited(n,false) {
+    : T(n), _visited(n), _i2n(n) {
     typedef typename boost::property_map<T, N2I>::type N2iMap;
     N2iMap n2i = get(N2I(),*this);
     
@@ -136,6 +223,13 @@ public:
       n2i[*i]=counter++;
     }
   }
+
+  // use the parallel sort, with nthreads threads once
+  // there are more than threshold nodes, when nthreads > 1.
+  void set_parallel(unsigned int nthreads,
+		    unsigned int threshold = PAR_SORT_DEFAULT_THRESHOLD) {
+    _par.configure(nthreads,threshold);
+  }
 };
 
 #endif
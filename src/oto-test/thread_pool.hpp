@@ -0,0 +1,160 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// A very small pool of persistent worker threads.  The idea is
+// that the parallel searches are invoked many times over, so it
+// makes sense to create the threads once and then park them on
+// a condition variable between jobs.  A job is a plain function
+// pointer which is run by every helper and by the calling thread
+// (which always gets id 0).  The call to run() returns only once
+// all of them have finished.
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <pthread.h>
+#include <stdexcept>
+#include <vector>
+
+class oto_thread_pool {
+public:
+  typedef void (*job_t)(void *arg, unsigned int id);
+private:
+  struct helper_arg {
+    oto_thread_pool *pool;
+    unsigned int id;
+  };
+
+  std::vector<pthread_t> _threads;
+  std::vector<helper_arg> _args;
+  pthread_mutex_t _lock;
+  pthread_cond_t _start;
+  pthread_cond_t _done;
+  unsigned int _generation; // incremented for each new job
+  unsigned int _running;    // helpers still working on this job
+  bool _shutdown;
+  job_t _job;
+  void *_arg;
+public:
+  // n is the total number of threads, including the caller.
+  oto_thread_pool(unsigned int n)
+    : _args(n > 1 ? n-1 : 0), _generation(0), _running(0),
+      _shutdown(false), _job(NULL), _arg(NULL) {
+    pthread_mutex_init(&_lock,NULL);
+    pthread_cond_init(&_start,NULL);
+    pthread_cond_init(&_done,NULL);
+    for(unsigned int i=0;i!=_args.size();++i) {
+      pthread_t t;
+      _args[i].pool = this;
+      _args[i].id = i+1;
+      if(pthread_create(&t,NULL,helper_main,&_args[i]) != 0) {
+	break;
+      }
+      _threads.push_back(t);
+    }
+  }
+
+  ~oto_thread_pool() {
+    pthread_mutex_lock(&_lock);
+    _shutdown = true;
+    pthread_cond_broadcast(&_start);
+    pthread_mutex_unlock(&_lock);
+    for(unsigned int i=0;i!=_threads.size();++i) {
+      pthread_join(_threads[i],NULL);
+    }
+    pthread_cond_destroy(&_done);
+    pthread_cond_destroy(&_start);
+    pthread_mutex_destroy(&_lock);
+  }
+
+  // total number of threads which take part
+  // in a job (the caller included).
+  unsigned int size(void) const { return _threads.size() + 1; }
+
+  void run(job_t job, void *arg) {
+    pthread_mutex_lock(&_lock);
+    _job = job;
+    _arg = arg;
+    _running = _threads.size();
+    ++_generation;
+    pthread_cond_broadcast(&_start);
+    pthread_mutex_unlock(&_lock);
+
+    job(arg,0);
+
+    pthread_mutex_lock(&_lock);
+    while(_running != 0) {
+      pthread_cond_wait(&_done,&_lock);
+    }
+    pthread_mutex_unlock(&_lock);
+  }
+private:
+  // not copyable
+  oto_thread_pool(oto_thread_pool const &);
+  void operator=(oto_thread_pool const &);
+
+  static void *helper_main(void *p) {
+    helper_arg *a((helper_arg*) p);
+    oto_thread_pool &pool(*a->pool);
+    unsigned int seen(0);
+
+    pthread_mutex_lock(&pool._lock);
+    while(true) {
+      while(!pool._shutdown && pool._generation == seen) {
+	pthread_cond_wait(&pool._start,&pool._lock);
+      }
+      if(pool._shutdown) { break; }
+      seen = pool._generation;
+      job_t job(pool._job);
+      void *arg(pool._arg);
+      pthread_mutex_unlock(&pool._lock);
+
+      job(arg,a->id);
+
+      pthread_mutex_lock(&pool._lock);
+      if(--pool._running == 0) {
+	pthread_cond_signal(&pool._done);
+      }
+    }
+    pthread_mutex_unlock(&pool._lock);
+    return NULL;
+  }
+};
+
+// A pool which is only created when it is first needed.  Copying
+// one copies the number of threads, but not the threads themselves,
+// so that classes holding one can still be copied.
+
+class oto_lazy_pool {
+private:
+  unsigned int _n;
+  oto_thread_pool *_pool;
+public:
+  oto_lazy_pool(unsigned int n = 1) : _n(n), _pool(NULL) {}
+
+  oto_lazy_pool(oto_lazy_pool const &src) : _n(src._n), _pool(NULL) {}
+
+  ~oto_lazy_pool() { delete _pool; }
+
+  void operator=(oto_lazy_pool const &src) {
+    if(&src != this) {
+      delete _pool;
+      _pool = NULL;
+      _n = src._n;
+    }
+  }
+
+  oto_thread_pool &get(void) {
+    if(_pool == NULL) { _pool = new oto_thread_pool(_n); }
+    return *_pool;
+  }
+};
+
+#endif
@@ -0,0 +1,134 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// The level of a node is the length of the longest path reaching it
+// from a node with no predecessors (whose level is 0).  Nodes on the
+// same level have no paths between them, so each level is a wave of
+// work which can be done in parallel.
+//
+// The levels can be kept up to date alongside any of the online
+// topological orders, since only n2i is needed.  Adding t->h can
+// only raise levels, and only those of nodes reachable from h.  These
+// are visited lowest n2i first, using a heap.  So, when a node comes
+// off the heap, all of its predecessors which have been raised have
+// been visited already, and its level is final.  Only nodes whose
+// level actually goes up are put on the heap.
+
+#ifndef TOPOLOGICAL_LEVELS_HPP
+#define TOPOLOGICAL_LEVELS_HPP
+
+#include <algorithm>
+#include <vector>
+#include <boost/graph/topological_sort.hpp>
+#include "visit_marks.hpp"
+
+// these globals are not strictly needed
+// they are used to generate the metrics
+#ifdef LEVELS_GENERATE_STATS
+extern unsigned int levels_nraised;
+#endif
+
+template<class G, class N2iMap>
+class topological_levels {
+private:
+  typedef typename G::vertex_descriptor vd_t;
+  typedef typename G::out_edge_iterator out_iterator;
+  typedef typename G::in_edge_iterator in_iterator;
+
+  // orders the heap lowest n2i first
+  struct heap_comp {
+    N2iMap n2i;
+    heap_comp(N2iMap m) : n2i(m) {}
+    bool operator()(vd_t a, vd_t b) const { return n2i[b] < n2i[a]; }
+  };
+
+  std::vector<unsigned int> _level;
+  unsigned int _depth; // the highest level
+  visit_marks _queued;
+  // scratch space, kept between insertions
+  // so that they don't need to allocate.
+  std::vector<vd_t> _heap;
+  std::vector<vd_t> _order;
+public:
+  topological_levels(G const &g) : _depth(0), _queued(num_vertices(g)) {
+    recompute(g);
+  }
+
+  unsigned int level(vd_t v) const { return _level[v]; }
+
+  unsigned int depth(void) const { return _depth; }
+
+  // Work out every level from scratch, in O(V+E) time.
+  // The graph must be acyclic.  Each node's predecessors
+  // are done before it, so its old level is only read to
+  // count it as raised, as edge_added() would have.
+
+  void recompute(G const &g) {
+#ifdef LEVELS_GENERATE_STATS
+    bool counting(_level.size() == num_vertices(g));
+#endif
+    _order.clear();
+    topological_sort(g,std::back_inserter(_order));
+    _level.resize(num_vertices(g));
+    _depth = 0;
+    // the sort leaves the nodes in reverse order
+    for(typename std::vector<vd_t>::reverse_iterator i(_order.rbegin());
+	i!=_order.rend();++i) {
+      unsigned int l(0);
+      in_iterator j,jend;
+      for(tie(j,jend) = in_edges(*i,g);j!=jend;++j) {
+	l = std::max(l,_level[source(*j,g)] + 1);
+      }
+#ifdef LEVELS_GENERATE_STATS
+      if(counting && l > _level[*i]) { ++levels_nraised; }
+#endif
+      _level[*i] = l;
+      _depth = std::max(_depth,l);
+    }
+  }
+
+  // Call once t->h has been added, and the order
+  // (given by n2i) brought up to date.
+
+  void edge_added(vd_t t, vd_t h, G const &g, N2iMap n2i) {
+    if(_level[h] > _level[t]) { return; }
+    heap_comp comp(n2i);
+    std::vector<vd_t> &heap(_heap);
+    heap.clear();
+    _queued.clear();
+    _level[h] = _level[t] + 1;
+    _queued.mark(h);
+    heap.push_back(h);
+    while(!heap.empty()) {
+      vd_t x(heap.front());
+      std::pop_heap(heap.begin(),heap.end(),comp);
+      heap.pop_back();
+      unsigned int l(_level[x] + 1);
+      _depth = std::max(_depth,_level[x]);
+#ifdef LEVELS_GENERATE_STATS
+      ++levels_nraised;
+#endif
+      out_iterator i,iend;
+      for(tie(i,iend) = out_edges(x,g);i!=iend;++i) {
+	vd_t w(target(*i,g));
+	if(_level[w] < l) {
+	  _level[w] = l;
+	  if(!_queued.marked(w)) {
+	    _queued.mark(w);
+	    heap.push_back(w);
+	    std::push_heap(heap.begin(),heap.end(),comp);
+	  }
+	}
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,56 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// A set of visited flags which can be cleared in constant time.
+// Rather than one bit per node, each node has a 32-bit stamp and
+// a node is marked only when its stamp equals the current epoch.
+// So, clearing all of the marks is simply a matter of moving on
+// to the next epoch, which saves the second pass over the nodes
+// touched by a search that would otherwise be needed to reset
+// them.  Only when the epoch wraps around are the stamps actually
+// reset.
+
+#ifndef VISIT_MARKS_HPP
+#define VISIT_MARKS_HPP
+
+#include <vector>
+#include <algorithm>
+
+class visit_marks {
+private:
+  std::vector<unsigned int> _stamp;
+  unsigned int _epoch; // never zero
+public:
+  visit_marks(unsigned int n = 0)
+    : _stamp(n,0), _epoch(1) {
+  }
+
+  unsigned int size(void) const { return _stamp.size(); }
+
+  void resize(unsigned int n) { _stamp.resize(n,0); }
+
+  bool marked(unsigned int i) const { return _stamp[i] == _epoch; }
+
+  void mark(unsigned int i) { _stamp[i] = _epoch; }
+
+  void unmark(unsigned int i) { _stamp[i] = 0; }
+
+  // unmark everything
+  void clear(void) {
+    if(++_epoch == 0) {
+      // the epoch has wrapped around,
+      // so the stamps must be reset.
+      std::fill(_stamp.begin(),_stamp.end(),0);
+      _epoch = 1;
+    }
+  }
+};
+
+#endif
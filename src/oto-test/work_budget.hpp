@@ -0,0 +1,168 @@
+// (C) Copyright David James Pearce 2003. Permission to copy, use,
+// modify, sell and distribute this software is granted provided this
+// copyright notice appears in all copies. This software is provided
+// "as is" without express or implied warranty, and with no claim as
+// to its suitability for any purpose.
+//
+// Email: david.pearce@mcs.vuw.ac.nz
+//
+// Notes
+// =====
+// Bounds the work done by one insertion.  Work is measured in nodes
+// plus edges visited, which is also what an offline topological
+// sort costs.  Once the search for an insertion has done more work
+// than the budget allows, it is abandoned and the whole graph is
+// sorted again instead.
+//
+// The budget is a multiple of the cost of an offline sort, which
+// is taken from the last one actually done (plus any edges added
+// since).  However, a search is only part of the cost of an
+// insertion, since the affected nodes must then be reordered.  So,
+// the ratio of reordering to searching seen on completed insertions
+// is tracked, and the search is allowed only its share.
+
+#ifndef WORK_BUDGET_HPP
+#define WORK_BUDGET_HPP
+
+#include <vector>
+#include <climits>
+#include "visit_marks.hpp"
+#include "dfs_frame.hpp"
+
+#ifdef BUDGET_GENERATE_STATS
+extern unsigned int budget_nfallbacks;
+#endif
+
+// the budget as a multiple of the cost of
+// an offline sort, when turned on.
+#define BUDGET_DEFAULT_FACTOR 1.0
+
+class work_budget {
+private:
+  double _factor;         // zero means there is no budget
+  double _ratio;          // average of reorder work over search work
+  unsigned int _estimate; // cost of an offline sort
+  unsigned int _nedges;   // number of edges when estimate was made
+  unsigned int _limit;
+  unsigned int _spent;
+public:
+  work_budget(double factor = 0)
+    : _factor(factor), _ratio(0), _estimate(0), _nedges(0),
+      _limit(UINT_MAX), _spent(0) {
+  }
+
+  void configure(double factor) {
+    _factor = factor;
+    _ratio = 0;
+    _estimate = 0;
+  }
+
+  bool active(void) const { return _factor > 0; }
+
+  // begin an insertion into a graph of nv nodes and ne edges
+  void start(unsigned int nv, unsigned int ne) {
+    _spent = 0;
+    if(!active()) {
+      _limit = UINT_MAX;
+      return;
+    }
+    if(_estimate == 0) {
+      _estimate = nv + ne;
+    } else {
+      _estimate += ne - _nedges;
+    }
+    _nedges = ne;
+    _limit = (unsigned int) ((_factor * _estimate) / (1.0 + _ratio));
+  }
+
+  // don't limit the rest of this insertion
+  void lift(void) { _limit = UINT_MAX; }
+
+  // charge n units of work, returning
+  // false once the budget is exceeded.
+  bool charge(unsigned int n) {
+    _spent += n;
+    return _spent <= _limit;
+  }
+
+  bool exceeded(void) const { return _spent > _limit; }
+
+  unsigned int remaining(void) const {
+    return _spent >= _limit ? 0 : _limit - _spent;
+  }
+
+  // the work charged since start
+  unsigned int spent(void) const { return _spent; }
+
+  // an insertion finished within the budget
+  void completed(unsigned int reorder) {
+    if(active() && _spent > 0) {
+      _ratio = 0.9 * _ratio + 0.1 * (((double) reorder) / _spent);
+    }
+  }
+
+  // an offline sort was done instead
+  void fallback(unsigned int cost) {
+    _estimate = cost;
+#ifdef BUDGET_GENERATE_STATS
+    ++budget_nfallbacks;
+#endif
+  }
+};
+
+// The offline sort used as the fallback.  This is an ordinary
+// depth-first search, done iteratively.  The nodes are written to
+// order in topological order, and cost is set to the number of
+// nodes and edges visited.  Returns false if the graph has a
+// cycle, which is found as an edge to a node still on the stack.
+
+template<class G>
+bool offline_topological_sort(G const &g,
+			      std::vector<typename G::vertex_descriptor> &order,
+			      visit_marks &visited, visit_marks &done,
+			      std::vector<dfs_frame<typename G::vertex_descriptor,
+			                            typename G::out_edge_iterator> > &stack,
+			      unsigned int &cost) {
+  typedef typename G::vertex_descriptor vd_t;
+  typedef dfs_frame<vd_t,typename G::out_edge_iterator> frame;
+  unsigned int n(num_vertices(g));
+  unsigned int count(n);
+
+  if(visited.size() < n) { visited.resize(n); }
+  if(done.size() < n) { done.resize(n); }
+  visited.clear();
+  done.clear();
+  order.resize(n);
+  cost = 0;
+
+  for(unsigned int r=0;r!=n;++r) {
+    if(visited.marked(r)) { continue; }
+    stack.clear();
+    visited.mark(r);
+    ++cost;
+    stack.push_back(frame(r,out_edges(r,g)));
+    while(!stack.empty()) {
+      frame &f(stack.back());
+      if(f.i == f.iend) {
+	// all successors done
+	done.mark(f.v);
+	order[--count] = f.v;
+	stack.pop_back();
+	continue;
+      }
+      vd_t w(target(*f.i,g));
+      ++f.i;
+      ++cost;
+      if(!visited.marked(w)) {
+	visited.mark(w);
+	++cost;
+	stack.push_back(frame(w,out_edges(w,g)));
+      } else if(!done.marked(w)) {
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+#endif